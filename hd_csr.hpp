@@ -0,0 +1,53 @@
+#ifndef HD_CSR_H
+#define HD_CSR_H
+
+// sparse matrix in compressed sparse row format (e.g. for assembled stencil operators)
+//
+// row i contains the entries row_ptr[i] ... row_ptr[i+1]-1 of col and val, sorted by
+// column without duplicate columns (as required by most sparse solvers; all matrices
+// assembled in hd, e.g. hd::assemble_csr() and hd::rbf_fd_operators(), follow it)
+//
+// Usage:
+//
+// hd::csr_matrix a = ...;
+// a.multiply(x, y);      // y = a * x (x.size() == a.ncols, y.size() == a.nrows)
+
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+struct csr_matrix {
+    std::size_t nrows{0};
+    std::size_t ncols{0};
+    std::vector<std::size_t> row_ptr; // nrows + 1 entries, row_ptr[0] == 0
+    std::vector<std::size_t> col;     // column index of entries
+    std::vector<double> val;          // value of entries
+
+    std::size_t nnz() const { return val.size(); }
+
+    void multiply(std::span<double const> x, std::span<double> y) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline void csr_matrix::multiply(std::span<double const> x, std::span<double> y) const
+{
+    if (x.size() != ncols || y.size() != nrows) {
+        throw std::invalid_argument("hd::csr_matrix::multiply(): vector sizes incompatible.");
+    }
+    for (std::size_t i = 0; i < nrows; ++i) {
+        double sum = 0.0;
+        for (std::size_t p = row_ptr[i]; p < row_ptr[i + 1]; ++p)
+            sum += val[p] * x[col[p]];
+        y[i] = sum;
+    }
+}
+
+} // namespace hd
+
+#endif // HD_CSR_H
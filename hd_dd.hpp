@@ -0,0 +1,135 @@
+#ifndef HD_DD_H
+#define HD_DD_H
+
+// double-double arithmetic: value = hi + lo with |lo| <= ulp(hi)/2 (about 32 digits)
+//
+// based on the error free transformations two_sum (knuth) and two_prod (by fma), cmp.
+// Hida, Li, Bailey: "Library for double-double and quad-double arithmetic" (QD library)
+//
+// Much cheaper than long double or multiple precision libraries, but only correct with
+// strict IEEE semantics, i.e. must not be compiled with -ffast-math (or -Ofast).
+//
+// Usage:
+//
+// hd::dd_real a{1.0}, b{3.0};
+// hd::dd_real c = a / b;      // 1/3 with ~32 digits
+// double d = to_double(c);    // rounded to double
+
+#include <cmath> // std::fma(), std::abs()
+
+namespace hd {
+
+struct dd_real {
+    double hi{0.0};
+    double lo{0.0};
+
+    // explicit: no implicit conversion of double arguments to the dd_real overloads
+    // (e.g. hd::abs()) in unqualified calls within namespace hd
+    constexpr dd_real() = default;
+    explicit constexpr dd_real(double h) :
+        hi{h} {}
+    constexpr dd_real(double h, double l) :
+        hi{h}, lo{l} {}
+
+    constexpr dd_real& operator=(double h)
+    {
+        hi = h;
+        lo = 0.0;
+        return *this;
+    }
+};
+
+inline double to_double(dd_real a) { return a.hi + a.lo; }
+
+namespace detail {
+
+// s + e == a + b exactly
+inline dd_real two_sum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    double e = (a - (s - bb)) + (b - bb);
+    return {s, e};
+}
+
+// s + e == a + b exactly, requires |a| >= |b|
+inline dd_real quick_two_sum(double a, double b)
+{
+    double s = a + b;
+    double e = b - (s - a);
+    return {s, e};
+}
+
+// p + e == a * b exactly
+inline dd_real two_prod(double a, double b)
+{
+    double p = a * b;
+    double e = std::fma(a, b, -p);
+    return {p, e};
+}
+
+} // namespace detail
+
+inline dd_real operator-(dd_real a) { return {-a.hi, -a.lo}; }
+
+inline dd_real operator+(dd_real a, dd_real b)
+{
+    dd_real s = detail::two_sum(a.hi, b.hi);
+    dd_real t = detail::two_sum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = detail::quick_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    return detail::quick_two_sum(s.hi, s.lo);
+}
+
+inline dd_real operator+(dd_real a, double b)
+{
+    dd_real s = detail::two_sum(a.hi, b);
+    s.lo += a.lo;
+    return detail::quick_two_sum(s.hi, s.lo);
+}
+
+inline dd_real operator-(dd_real a, dd_real b) { return a + (-b); }
+inline dd_real operator-(dd_real a, double b) { return a + (-b); }
+
+inline dd_real operator*(dd_real a, dd_real b)
+{
+    dd_real p = detail::two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return detail::quick_two_sum(p.hi, p.lo);
+}
+
+inline dd_real operator*(dd_real a, double b)
+{
+    dd_real p = detail::two_prod(a.hi, b);
+    p.lo += a.lo * b;
+    return detail::quick_two_sum(p.hi, p.lo);
+}
+
+// long division: quotient of hi parts corrected twice
+inline dd_real operator/(dd_real a, dd_real b)
+{
+    double q1 = a.hi / b.hi;
+    dd_real r = a - b * q1;
+    double q2 = r.hi / b.hi;
+    r = r - b * q2;
+    double q3 = r.hi / b.hi;
+    return detail::quick_two_sum(q1, q2) + q3;
+}
+
+inline dd_real operator/(dd_real a, double b) { return a / dd_real(b); }
+
+inline dd_real& operator+=(dd_real& a, dd_real b) { return a = a + b; }
+inline dd_real& operator-=(dd_real& a, dd_real b) { return a = a - b; }
+inline dd_real& operator*=(dd_real& a, dd_real b) { return a = a * b; }
+inline dd_real& operator/=(dd_real& a, dd_real b) { return a = a / b; }
+
+inline bool operator==(dd_real a, dd_real b) { return a.hi == b.hi && a.lo == b.lo; }
+inline bool operator<(dd_real a, dd_real b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+inline bool operator>(dd_real a, dd_real b) { return b < a; }
+
+inline dd_real abs(dd_real a) { return (a.hi < 0.0) ? -a : a; }
+
+} // namespace hd
+
+#endif // HD_DD_H
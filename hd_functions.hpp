@@ -179,7 +179,7 @@ double bico(int n, int k)
 int oo_magnitude(double x, split_t s)
 {
 
-    if (abs(x) <= std::numeric_limits<double>::min())
+    if (std::abs(x) <= std::numeric_limits<double>::min())
         return 0;
 
     if (s == split_t::geometric) // geometric split (default)
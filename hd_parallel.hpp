@@ -0,0 +1,80 @@
+#ifndef HD_PARALLEL_H
+#define HD_PARALLEL_H
+
+// simple fork-join parallel loop over an index range [0, n)
+//
+// The range is split into one contiguous chunk per thread; f is called once per chunk as
+// f(begin, end, thread_id), i.e. per-thread scratch memory can be set up once per chunk.
+// Exceptions thrown by f are rethrown in the calling thread (the first one only).
+//
+// Usage:
+//
+// hd::parallel_for(n, [&](std::size_t i0, std::size_t i1, unsigned tid) {
+//     std::vector<double> scratch(...);        // per thread
+//     for (std::size_t i = i0; i < i1; ++i) ...
+// });
+
+#include <algorithm> // std::min()
+#include <cstddef>
+#include <exception> // std::exception_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hd {
+
+// number of threads used by default (hardware concurrency, at least 1)
+inline unsigned default_threads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+template <class F>
+void parallel_for(std::size_t n, F&& f, unsigned nthreads = 0);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+template <class F>
+void parallel_for(std::size_t n, F&& f, unsigned nthreads)
+{
+    if (n == 0) return;
+    if (nthreads == 0) nthreads = default_threads();
+    nthreads = static_cast<unsigned>(std::min<std::size_t>(nthreads, n));
+
+    if (nthreads == 1) {
+        f(std::size_t(0), n, 0u);
+        return;
+    }
+
+    std::exception_ptr error;
+    std::mutex mtx;
+    auto run = [&](std::size_t i0, std::size_t i1, unsigned tid) {
+        try {
+            f(i0, i1, tid);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    // chunks differ in size by one index at most; chunk 0 is done by the calling thread
+    std::size_t chunk = n / nthreads, rest = n % nthreads;
+    auto begin = [&](unsigned t) { return t * chunk + std::min<std::size_t>(t, rest); };
+
+    std::vector<std::jthread> threads;
+    threads.reserve(nthreads - 1);
+    for (unsigned t = 1; t < nthreads; ++t)
+        threads.emplace_back(run, begin(t), begin(t + 1), t);
+    run(begin(0), begin(1), 0u);
+    threads.clear(); // join
+
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace hd
+
+#endif // HD_PARALLEL_H
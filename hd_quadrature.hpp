@@ -0,0 +1,110 @@
+#ifndef HD_QUADRATURE_H
+#define HD_QUADRATURE_H
+
+// high order quadrature weights on arbitrary (nonuniform) 1D grids
+//
+// Each interval [x_k, x_k+1] is integrated with the np grid points around it (one-sided
+// at the boundaries). The weights follow from the moment conditions
+//
+//   sum_j w_j (x_j - c)^i / i! = int_{x_k}^{x_k+1} (x - c)^i / i! dx,   i = 0 ... np-1
+//
+// (c: midpoint of the interval), i.e. they are exact for polynomials of degree np-1.
+// The interval weights are summed into one weight per grid point, i.e. after computing
+// the weights once per grid each integral is a single dot product.
+// np == 2 is the trapezoidal rule.
+//
+// Usage:
+//
+// std::vector<double> w = hd::quadrature_weights(x, 4);   // once per grid
+// double integral = hd::integrate(w, f);                  // for each field f
+
+#include "hd/hd_solver.hpp"  // hd::lu_decomp(), hd::lu_backsubs()
+#include "hd/hd_stencil.hpp" // hd::detail::moment_column()
+
+#include <algorithm> // std::clamp()
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+std::vector<double> quadrature_weights(std::span<double const> x, std::size_t np = 4);
+
+double integrate(std::span<double const> w, std::span<double const> f);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline std::vector<double> quadrature_weights(std::span<double const> x, std::size_t np)
+{
+    std::size_t n = x.size();
+    if (np < 2 || n < np) {
+        throw std::invalid_argument("hd::quadrature_weights(): np < 2 or less grid points than np.");
+    }
+    for (std::size_t k = 0; k + 1 < n; ++k) {
+        if (!(x[k + 1] > x[k])) {
+            throw std::invalid_argument("hd::quadrature_weights(): grid not strictly increasing.");
+        }
+    }
+
+    std::vector<double> w(n, 0.0);
+
+    std::vector<double> mem_m(np * np), mem_vv(np), mem_rhs(np);
+    std::vector<int> mem_perm(np);
+    mdspan m{mem_m.data(), np, np};
+    mdspan<int, dextents<std::size_t, 1>> perm{mem_perm.data(), np};
+    mdspan<double, dextents<std::size_t, 1>> vv{mem_vv.data(), np};
+    mdspan<double, dextents<std::size_t, 1>> rhs{mem_rhs.data(), np};
+
+    for (std::size_t k = 0; k + 1 < n; ++k) {
+        // np points around interval k
+        std::ptrdiff_t f0 = std::ptrdiff_t(k) - std::ptrdiff_t(np / 2 - 1);
+        std::size_t f = std::clamp<std::ptrdiff_t>(f0, 0, n - np);
+
+        // moment system in coordinates centered at the midpoint, scaled by interval length
+        double h = x[k + 1] - x[k];
+        double c = 0.5 * (x[k] + x[k + 1]);
+        for (std::size_t j = 0; j < np; ++j)
+            detail::moment_column(m, j, (x[f + j] - c) / h);
+        // int_{-1/2}^{1/2} xi^i / i! dxi = 2 (1/2)^(i+1) / (i+1)! for even i, 0 otherwise
+        double term = 0.5;
+        for (std::size_t i = 0; i < np; ++i) {
+            rhs[i] = (i % 2 == 0) ? 2.0 * term : 0.0;
+            term *= 0.5 / (i + 2);
+        }
+
+        lu_decomp(m, perm, vv);
+        lu_backsubs(m, perm, rhs);
+
+        for (std::size_t j = 0; j < np; ++j)
+            w[f + j] += h * rhs[j];
+    }
+    return w;
+}
+
+//******************************************************************************
+// dot product with four independent partial sums (vectorizes without -ffast-math)
+//******************************************************************************
+inline double integrate(std::span<double const> w, std::span<double const> f)
+{
+    if (w.size() != f.size()) {
+        throw std::invalid_argument("hd::integrate(): sizes of weights and values differ.");
+    }
+    std::size_t n = w.size(), n4 = n - n % 4;
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (std::size_t i = 0; i < n4; i += 4) {
+        s0 += w[i] * f[i];
+        s1 += w[i + 1] * f[i + 1];
+        s2 += w[i + 2] * f[i + 2];
+        s3 += w[i + 3] * f[i + 3];
+    }
+    for (std::size_t i = n4; i < n; ++i)
+        s0 += w[i] * f[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace hd
+
+#endif // HD_QUADRATURE_H
@@ -0,0 +1,443 @@
+#ifndef HD_RBF_FD_H
+#define HD_RBF_FD_H
+
+// derivative operators on scattered points in 2D/3D by RBF-FD
+// (polyharmonic spline phi(r) = r^3 augmented by polynomials up to a given degree)
+//
+// For each point the weights of its k nearest neighbours (incl. itself) follow from the
+// local saddle point system
+//
+//   [ A   P ] [ w      ]   [ L phi(|x - x_j|) at x_c ]
+//   [ P^T 0 ] [ lambda ] = [ L p_q at x_c            ]
+//
+// with A_jl = phi(|x_j - x_l|) and P_jq = p_q(x_j), i.e. the operator is exact for all
+// polynomials up to the degree of the augmentation. The system is set up in coordinates
+// centered at x_c and scaled by the stencil radius, LU-factored once and solved for all
+// requested operators. The points are processed in parallel (per-thread scratch memory),
+// the local systems of par.batch points at a time are stored interleaved and factored
+// together (hd::lu_decomp_batch(), inner loops over the systems). The weights are written
+// directly into one sparse matrix per operator (k entries per row, sorted by column).
+//
+// Usage:
+//
+// std::vector<std::array<double, 2>> pts = ...;
+// std::vector<hd::rbf_op> ops{hd::rbf_op::dx, hd::rbf_op::laplacian};
+// auto mat = hd::rbf_fd_operators<2>(pts, ops);  // mat[0]: d/dx, mat[1]: laplacian
+// mat[1].multiply(f, lap_f);
+
+#include "hd/hd_csr.hpp"      // hd::csr_matrix
+#include "hd/hd_parallel.hpp" // hd::parallel_for()
+#include "hd/hd_solver.hpp"   // hd::lu_decomp_batch(), hd::lu_backsubs_batch()
+
+#include <algorithm> // std::min(), std::max(), std::nth_element(), std::partial_sort(), std::sort()
+#include <array>
+#include <cmath> // std::sqrt(), std::ceil(), std::pow()
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+template <int D>
+using point_t = std::array<double, D>;
+
+enum class rbf_op { dx, dy, dz, dxx, dyy, dzz, dxy, dxz, dyz, laplacian };
+
+struct rbf_fd_param {
+    int poly_degree{2};   // degree of polynomial augmentation (>= 1)
+    int nneighbours{0};   // stencil size incl. center (0: 2 * number of polynomials + 1)
+    unsigned nthreads{0}; // number of threads (0: hd::default_threads())
+    std::size_t batch{8}; // local systems factored together (interleaved, vectorized)
+};
+
+// k nearest neighbours in a point cloud (uniform cell list)
+template <int D>
+class point_cloud_index {
+  public:
+    point_cloud_index(std::span<point_t<D> const> pts, std::size_t points_per_cell = 4);
+
+    // indices of the nb.size() nearest points to x sorted by distance
+    // (cand: scratch of the caller, avoids allocations for repeated queries)
+    void knn(point_t<D> const& x, std::span<std::size_t> nb,
+             std::vector<std::pair<double, std::size_t>>& cand) const;
+
+  private:
+    std::span<point_t<D> const> pts;
+    point_t<D> lo;                    // lower corner of bounding box
+    point_t<D> edge;                  // edge length of cells
+    std::array<int, D> dims;          // number of cells per axis
+    std::vector<std::size_t> c_first; // first entry of each cell in c_pts (+ end)
+    std::vector<std::size_t> c_pts;   // point indices ordered by cell
+
+    std::array<int, D> cell_of(point_t<D> const& x) const;
+    std::size_t cell_index(std::array<int, D> const& c) const;
+};
+
+template <int D>
+std::vector<csr_matrix> rbf_fd_operators(std::span<point_t<D> const> pts,
+                                         std::span<rbf_op const> ops, rbf_fd_param const& par = {});
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+template <int D>
+point_cloud_index<D>::point_cloud_index(std::span<point_t<D> const> pts,
+                                        std::size_t points_per_cell) :
+    pts{pts}
+{
+    static_assert(D == 2 || D == 3, "hd::point_cloud_index: only 2D and 3D supported.");
+    if (pts.empty() || points_per_cell == 0) {
+        throw std::invalid_argument("hd::point_cloud_index: no points.");
+    }
+
+    point_t<D> hi = pts[0];
+    lo = pts[0];
+    for (auto const& p : pts)
+        for (int a = 0; a < D; ++a) {
+            lo[a] = std::min(lo[a], p[a]);
+            hi[a] = std::max(hi[a], p[a]);
+        }
+
+    // cubic cells with about points_per_cell points on average
+    double vol = 1.0, emax = 0.0;
+    for (int a = 0; a < D; ++a)
+        emax = std::max(emax, hi[a] - lo[a]);
+    if (emax == 0.0) emax = 1.0;
+    for (int a = 0; a < D; ++a)
+        vol *= std::max(hi[a] - lo[a], 1.0e-3 * emax);
+    double h = std::pow(vol * points_per_cell / pts.size(), 1.0 / D);
+
+    std::size_t ncells = 1;
+    for (int a = 0; a < D; ++a) {
+        dims[a] = std::max(1, static_cast<int>(std::ceil((hi[a] - lo[a]) / h)));
+        edge[a] = std::max((hi[a] - lo[a]) / dims[a], 1.0e-300);
+        ncells *= dims[a];
+    }
+
+    // counting sort of points by cell
+    c_first.assign(ncells + 1, 0);
+    std::vector<std::size_t> cell(pts.size());
+    for (std::size_t i = 0; i < pts.size(); ++i) {
+        cell[i] = cell_index(cell_of(pts[i]));
+        ++c_first[cell[i] + 1];
+    }
+    for (std::size_t c = 0; c < ncells; ++c)
+        c_first[c + 1] += c_first[c];
+    c_pts.resize(pts.size());
+    std::vector<std::size_t> pos(c_first.begin(), c_first.end() - 1);
+    for (std::size_t i = 0; i < pts.size(); ++i)
+        c_pts[pos[cell[i]]++] = i;
+}
+
+template <int D>
+std::array<int, D> point_cloud_index<D>::cell_of(point_t<D> const& x) const
+{
+    std::array<int, D> c;
+    for (int a = 0; a < D; ++a)
+        c[a] = std::clamp(static_cast<int>((x[a] - lo[a]) / edge[a]), 0, dims[a] - 1);
+    return c;
+}
+
+template <int D>
+std::size_t point_cloud_index<D>::cell_index(std::array<int, D> const& c) const
+{
+    std::size_t idx = 0;
+    for (int a = 0; a < D; ++a)
+        idx = idx * dims[a] + c[a];
+    return idx;
+}
+
+//******************************************************************************
+// search in rings of cells around the cell of x: after ring r all points closer than
+// r * (min. cell edge) have been found, i.e. the search stops as soon as the k-th
+// candidate is within this distance
+//******************************************************************************
+template <int D>
+void point_cloud_index<D>::knn(point_t<D> const& x, std::span<std::size_t> nb,
+                               std::vector<std::pair<double, std::size_t>>& cand) const
+{
+    std::size_t k = nb.size();
+    if (k == 0) return;
+    if (k > pts.size()) {
+        throw std::invalid_argument("hd::point_cloud_index::knn(): more neighbours than points.");
+    }
+
+    std::array<int, D> c0 = cell_of(x);
+    double hmin = edge[0];
+    int rmax = 0;
+    for (int a = 0; a < D; ++a) {
+        hmin = std::min(hmin, edge[a]);
+        rmax = std::max(rmax, std::max(c0[a], dims[a] - 1 - c0[a]));
+    }
+
+    cand.clear();
+    for (int r = 0; r <= rmax; ++r) {
+        // all cells with chebyshev distance r from c0
+        std::array<int, D> o;
+        o.fill(-r);
+        while (true) {
+            bool on_ring = false, inside = true;
+            std::array<int, D> c;
+            for (int a = 0; a < D; ++a) {
+                on_ring = on_ring || o[a] == -r || o[a] == r;
+                c[a] = c0[a] + o[a];
+                inside = inside && c[a] >= 0 && c[a] < dims[a];
+            }
+            if (on_ring && inside) {
+                std::size_t ci = cell_index(c);
+                for (std::size_t p = c_first[ci]; p < c_first[ci + 1]; ++p) {
+                    std::size_t j = c_pts[p];
+                    double d2 = 0.0;
+                    for (int a = 0; a < D; ++a)
+                        d2 += (pts[j][a] - x[a]) * (pts[j][a] - x[a]);
+                    cand.emplace_back(d2, j);
+                }
+            }
+            // next offset (odometer)
+            int a = D - 1;
+            while (a >= 0 && o[a] == r) {
+                o[a] = -r;
+                --a;
+            }
+            if (a < 0) break;
+            ++o[a];
+        }
+
+        if (cand.size() >= k) {
+            std::nth_element(cand.begin(), cand.begin() + (k - 1), cand.end());
+            double rk = r * hmin;
+            if (cand[k - 1].first <= rk * rk) break;
+        }
+    }
+
+    std::partial_sort(cand.begin(), cand.begin() + k, cand.end());
+    for (std::size_t j = 0; j < k; ++j)
+        nb[j] = cand[j].second;
+}
+
+namespace detail {
+
+struct rbf_op_desc {
+    int order; // derivative order
+    int a, b;  // axes (laplacian: a == b == -1)
+};
+
+inline rbf_op_desc describe(rbf_op op, int dim)
+{
+    rbf_op_desc d;
+    switch (op) {
+        case rbf_op::dx: d = {1, 0, 0}; break;
+        case rbf_op::dy: d = {1, 1, 1}; break;
+        case rbf_op::dz: d = {1, 2, 2}; break;
+        case rbf_op::dxx: d = {2, 0, 0}; break;
+        case rbf_op::dyy: d = {2, 1, 1}; break;
+        case rbf_op::dzz: d = {2, 2, 2}; break;
+        case rbf_op::dxy: d = {2, 0, 1}; break;
+        case rbf_op::dxz: d = {2, 0, 2}; break;
+        case rbf_op::dyz: d = {2, 1, 2}; break;
+        default: d = {2, -1, -1}; break; // laplacian
+    }
+    if (d.a >= dim || d.b >= dim) {
+        throw std::invalid_argument("hd::rbf_fd_operators(): operator not available in dimension.");
+    }
+    return d;
+}
+
+// exponents of all monomials up to degree deg
+template <int D>
+std::vector<std::array<int, D>> monomials(int deg)
+{
+    std::vector<std::array<int, D>> m;
+    std::array<int, D> e{};
+    while (true) {
+        int sum = 0;
+        for (int a = 0; a < D; ++a)
+            sum += e[a];
+        if (sum <= deg) m.push_back(e);
+        int a = D - 1;
+        while (a >= 0 && e[a] == deg) {
+            e[a] = 0;
+            --a;
+        }
+        if (a < 0) break;
+        ++e[a];
+    }
+    return m;
+}
+
+// L phi(|x_c - x_j|) at x_c for phi(r) = r^3, d = x_c - x_j
+template <int D>
+double rbf_op_phi(rbf_op_desc const& op, point_t<D> const& d)
+{
+    double r2 = 0.0;
+    for (int a = 0; a < D; ++a)
+        r2 += d[a] * d[a];
+    double r = std::sqrt(r2);
+
+    if (op.order == 1) return 3.0 * r * d[op.a];
+    if (op.a < 0) return 3.0 * (D + 1) * r;
+    if (r == 0.0) return 0.0;
+    if (op.a == op.b) return 3.0 * (r + d[op.a] * d[op.a] / r);
+    return 3.0 * d[op.a] * d[op.b] / r;
+}
+
+// L p at the origin for monomial p with exponents e
+template <int D>
+double rbf_op_monomial(rbf_op_desc const& op, std::array<int, D> const& e)
+{
+    auto is = [&e](int a, int b) { // e == unit(a) + unit(b) (a == -1: zero)
+        for (int c = 0; c < D; ++c)
+            if (e[c] != (c == a) + (c == b)) return false;
+        return true;
+    };
+    if (op.order == 1) return is(op.a, -1) ? 1.0 : 0.0;
+    if (op.a < 0) {
+        double sum = 0.0;
+        for (int a = 0; a < D; ++a)
+            sum += is(a, a) ? 2.0 : 0.0;
+        return sum;
+    }
+    if (op.a == op.b) return is(op.a, op.a) ? 2.0 : 0.0;
+    return is(op.a, op.b) ? 1.0 : 0.0;
+}
+
+} // namespace detail
+
+template <int D>
+std::vector<csr_matrix> rbf_fd_operators(std::span<point_t<D> const> pts,
+                                         std::span<rbf_op const> ops, rbf_fd_param const& par)
+{
+    if (par.poly_degree < 1 || par.batch < 1 || ops.empty()) {
+        throw std::invalid_argument("hd::rbf_fd_operators(): poly_degree < 1, batch < 1 or no operators.");
+    }
+    std::vector<detail::rbf_op_desc> desc;
+    for (rbf_op op : ops)
+        desc.push_back(detail::describe(op, D));
+
+    auto mono = detail::monomials<D>(par.poly_degree);
+    std::size_t np = mono.size();
+    std::size_t k = par.nneighbours > 0 ? par.nneighbours : 2 * np + 1;
+    std::size_t n = pts.size();
+    if (k <= np || k > n) {
+        throw std::invalid_argument("hd::rbf_fd_operators(): number of neighbours inconsistent.");
+    }
+    std::size_t m = k + np; // size of local systems
+
+    // k entries per row: sparsity pattern known in advance, rows filled in parallel
+    std::vector<csr_matrix> mat(ops.size());
+    for (auto& a : mat) {
+        a.nrows = a.ncols = n;
+        a.row_ptr.resize(n + 1);
+        for (std::size_t i = 0; i <= n; ++i)
+            a.row_ptr[i] = i * k;
+        a.col.resize(n * k);
+        a.val.resize(n * k);
+    }
+
+    point_cloud_index<D> index(pts);
+
+    parallel_for(
+        n,
+        [&](std::size_t i0, std::size_t i1, unsigned) {
+            // per thread scratch for a batch of bs local systems (interleaved storage)
+            std::size_t bs = std::min(par.batch, i1 - i0);
+            std::vector<double> mem_a(m * m * bs), mem_rhs(m * bs), scale(bs);
+            std::vector<int> mem_perm(m * bs);
+            std::vector<std::size_t> nb(k * bs);
+            std::vector<std::pair<double, std::size_t>> cand;
+            std::vector<point_t<D>> xi(k * bs);
+
+            for (std::size_t b0 = i0; b0 < i1; b0 += bs) {
+                std::size_t cnt = std::min(bs, i1 - b0);
+                mdspan<double, dextents<std::size_t, 3>> a{mem_a.data(), m, m, cnt};
+                mdspan<int, dextents<std::size_t, 2>> perm{mem_perm.data(), m, cnt};
+                mdspan<double, dextents<std::size_t, 2>> rhs{mem_rhs.data(), m, cnt};
+
+                for (std::size_t b = 0; b < cnt; ++b) {
+                    std::size_t i = b0 + b;
+                    std::span<std::size_t> nbb{nb.data() + b * k, k};
+                    point_t<D>* x = xi.data() + b * k;
+                    index.knn(pts[i], nbb, cand);
+                    std::sort(nbb.begin(), nbb.end()); // csr: entries sorted by column
+
+                    // centered and scaled coordinates
+                    double s = 0.0;
+                    for (std::size_t j = 0; j < k; ++j) {
+                        double r2 = 0.0;
+                        for (int c = 0; c < D; ++c) {
+                            x[j][c] = pts[nbb[j]][c] - pts[i][c];
+                            r2 += x[j][c] * x[j][c];
+                        }
+                        s = std::max(s, std::sqrt(r2));
+                    }
+                    if (s == 0.0) {
+                        throw std::invalid_argument("hd::rbf_fd_operators(): coincident points.");
+                    }
+                    for (std::size_t j = 0; j < k; ++j)
+                        for (int c = 0; c < D; ++c)
+                            x[j][c] /= s;
+                    scale[b] = s;
+
+                    // local system
+                    for (std::size_t j = 0; j < k; ++j) {
+                        for (std::size_t l = 0; l < k; ++l) {
+                            double r2 = 0.0;
+                            for (int c = 0; c < D; ++c)
+                                r2 += (x[j][c] - x[l][c]) * (x[j][c] - x[l][c]);
+                            a[j, l, b] = r2 * std::sqrt(r2);
+                        }
+                        for (std::size_t q = 0; q < np; ++q) {
+                            double p = 1.0;
+                            for (int c = 0; c < D; ++c)
+                                for (int e = 0; e < mono[q][c]; ++e)
+                                    p *= x[j][c];
+                            a[j, k + q, b] = p;
+                            a[k + q, j, b] = p;
+                        }
+                    }
+                    for (std::size_t q = k; q < m; ++q)
+                        for (std::size_t l = k; l < m; ++l)
+                            a[q, l, b] = 0.0;
+                }
+
+                lu_decomp_batch(a, perm);
+
+                for (std::size_t o = 0; o < desc.size(); ++o) {
+                    for (std::size_t b = 0; b < cnt; ++b) {
+                        point_t<D> const* x = xi.data() + b * k;
+                        for (std::size_t j = 0; j < k; ++j) {
+                            point_t<D> d;
+                            for (int c = 0; c < D; ++c)
+                                d[c] = -x[j][c];
+                            rhs[j, b] = detail::rbf_op_phi<D>(desc[o], d);
+                        }
+                        for (std::size_t q = 0; q < np; ++q)
+                            rhs[k + q, b] = detail::rbf_op_monomial<D>(desc[o], mono[q]);
+                    }
+
+                    lu_backsubs_batch(a, perm, rhs);
+
+                    for (std::size_t b = 0; b < cnt; ++b) {
+                        // weights for scaled coordinates -> physical coordinates
+                        double s = scale[b];
+                        double sc = (desc[o].order == 1) ? 1.0 / s : 1.0 / (s * s);
+                        std::size_t i = b0 + b;
+                        for (std::size_t j = 0; j < k; ++j) {
+                            mat[o].col[i * k + j] = nb[b * k + j];
+                            mat[o].val[i * k + j] = rhs[j, b] * sc;
+                        }
+                    }
+                }
+            }
+        },
+        par.nthreads);
+
+    return mat;
+}
+
+} // namespace hd
+
+#endif // HD_RBF_FD_H
@@ -8,11 +8,30 @@
 // 1.) LU decomposition of matrix
 //
 // hd::lu_decomp(m, m_perm);
+// hd::lu_decomp(m, m_perm, scratch);  // without allocation (scratch.extent(0) >= m.extent(0))
 //
 // 2.) solution by backsubstition of rhs => solution is returned in rhs
 //     (can be repeated with many different rhs vectors for the same matrix)
 //
 // hd::lu_backsubs(m, m_perm, rhs);
+//
+// dense systems with any scalar type T (e.g. hd::dd_real), solution returned in rhs
+// (gaussian elimination with scaled partial pivoting, single rhs)
+//
+// hd::gauss_solve(m, rhs);
+//
+// banded systems without pivoting (e.g. diagonally dominant systems of compact schemes)
+// kl, ku: number of sub- and superdiagonals, band stored row by row: ab[i, j - i + kl]
+//
+// hd::band_lu_decomp(ab, kl, ku);
+// hd::band_lu_backsubs(ab, kl, ku, rhs);        // single rhs, or
+// hd::band_lu_backsubs_batch(ab, kl, ku, rhs);  // many rhs: rhs[i, m] for rhs vector m
+//
+// many independent small dense systems of the same size at once, stored interleaved:
+// a[i, j, s], perm[k, s], rhs[i, s] for system s (partial pivoting, inner loops over s)
+//
+// hd::lu_decomp_batch(a, perm);
+// hd::lu_backsubs_batch(a, perm, rhs);
 
 // use branch "single-header" from mdspan github
 //
@@ -29,8 +48,10 @@
 
 #include "mdspan/mdspan.hpp"
 
+#include <algorithm> // std::min(), std::max()
 #include <cmath>
 #include <iostream>
+#include <utility> // std::swap()
 #include <vector>
 
 // make mdspan less verbose
@@ -45,10 +66,28 @@ namespace hd { // Namespace hd to define my types for numerical computation
 
 void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
                mdspan<int, dextents<std::size_t, 1>> perm);
+void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
+               mdspan<int, dextents<std::size_t, 1>> perm,
+               mdspan<double, dextents<std::size_t, 1>> scratch);
 void lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> a,
                  mdspan<int const, dextents<std::size_t, 1>> perm,
                  mdspan<double, dextents<std::size_t, 1>> b);
 
+template <class T>
+void gauss_solve(mdspan<T, dextents<std::size_t, 2>> a, mdspan<T, dextents<std::size_t, 1>> b);
+
+void band_lu_decomp(mdspan<double, dextents<std::size_t, 2>> ab, int kl, int ku);
+void band_lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> ab, int kl, int ku,
+                      mdspan<double, dextents<std::size_t, 1>> b);
+void band_lu_backsubs_batch(mdspan<double const, dextents<std::size_t, 2>> ab, int kl, int ku,
+                            mdspan<double, dextents<std::size_t, 2>> b);
+
+void lu_decomp_batch(mdspan<double, dextents<std::size_t, 3>> a,
+                     mdspan<int, dextents<std::size_t, 2>> perm);
+void lu_backsubs_batch(mdspan<double const, dextents<std::size_t, 3>> a,
+                       mdspan<int const, dextents<std::size_t, 2>> perm,
+                       mdspan<double, dextents<std::size_t, 2>> b);
+
 //-----------------------------------------------------------------------------
 // Solver error handling
 //-----------------------------------------------------------------------------
@@ -64,32 +103,41 @@ struct Solver_error {
 
 inline void solver_error_msg(const char* p) { throw Solver_error(p); }
 
-void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
-               mdspan<int, dextents<std::size_t, 1>> perm)
+inline void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
+                      mdspan<int, dextents<std::size_t, 1>> perm)
+{
+    // helper for scaling the matrix rows
+    std::vector<double> vv(a.extent(0));
+
+    lu_decomp(a, perm, mdspan{vv.data(), vv.size()});
+}
+
+inline void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
+                      mdspan<int, dextents<std::size_t, 1>> perm,
+                      mdspan<double, dextents<std::size_t, 1>> vv)
 {
     /* LU decomposition of matrix a (handed back on a)
        perm is the permutation vector in case of line exchange (pivot elements)
+       vv is scratch space for scaling the matrix rows (at least the size of perm)
     */
 
-    // check fitness of matrix and permutation vector
+    // check fitness of matrix, permutation vector and scratch space
     if (a.extent(0) != a.extent(1) ||
-        a.extent(0) != perm.extent(0)) {
+        a.extent(0) != perm.extent(0) ||
+        vv.extent(0) < a.extent(0)) {
 
-        solver_error_msg("hd::lu_decomp(): unsymmetric matrix or permututation vector size incompatible.");
+        solver_error_msg("hd::lu_decomp(): unsymmetric matrix, permututation vector or scratch size incompatible.");
     };
 
     constexpr double TINY = 1.e-20;
     int ubound = a.extent(0) - 1; // highest valid index (=upper boundary)
 
-    // helper for scaling the matrix rows
-    std::vector<double> vv(a.extent(0));
-
     // fill in scaling vector
     for (int i = 0; i <= ubound; ++i) {
         double aamax = 0.;
         for (int j = 0; j <= ubound; ++j) {
-            if (abs(a[i, j]) > aamax)
-                aamax = abs(a[i, j]);
+            if (std::abs(a[i, j]) > aamax)
+                aamax = std::abs(a[i, j]);
         }
         if (aamax == 0.)
             solver_error_msg("hd::lu_decomp(): singular matrix.");
@@ -118,7 +166,7 @@ void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
                     sum -= a[i, k] * a[k, j];
                 a[i, j] = sum;
             }
-            dum = vv[i] * abs(sum);
+            dum = vv[i] * std::abs(sum);
             if (dum >= aamax) {
                 imax = i;
                 aamax = dum;
@@ -146,9 +194,9 @@ void lu_decomp(mdspan<double, dextents<std::size_t, 2>> a,
 
 } // ludecomp()
 
-void lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> a,
-                 mdspan<int const, dextents<std::size_t, 1>> perm,
-                 mdspan<double, dextents<std::size_t, 1>> b)
+inline void lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> a,
+                        mdspan<int const, dextents<std::size_t, 1>> perm,
+                        mdspan<double, dextents<std::size_t, 1>> b)
 {
     /*
     backward substitution: a is the LU-decomposed matrix as provided by lu_decomp()
@@ -201,6 +249,266 @@ void lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> a,
 
 } // lubacksubs()
 
+template <class T>
+void gauss_solve(mdspan<T, dextents<std::size_t, 2>> a, mdspan<T, dextents<std::size_t, 1>> b)
+{
+    /* solution of a*x = b returned on b, a is overwritten
+       T needs +, -, *, /, > and abs() (found by argument dependent lookup for class types)
+    */
+    using std::abs;
+
+    if (a.extent(0) != a.extent(1) || a.extent(0) != b.extent(0)) {
+        solver_error_msg("hd::gauss_solve(): unsymmetric matrix or right hand side size incompatible.");
+    }
+    int n = a.extent(0);
+
+    // scaling of rows (for pivot search only)
+    std::vector<T> vv(n);
+    for (int i = 0; i < n; ++i) {
+        T aamax{0.0};
+        for (int j = 0; j < n; ++j)
+            if (abs(a[i, j]) > aamax) aamax = abs(a[i, j]);
+        if (!(aamax > T{0.0})) solver_error_msg("hd::gauss_solve(): singular matrix.");
+        vv[i] = T{1.0} / aamax;
+    }
+
+    // forward elimination
+    for (int j = 0; j < n; ++j) {
+        int imax = j;
+        T pmax = abs(a[j, j]) * vv[j];
+        for (int i = j + 1; i < n; ++i) {
+            T p = abs(a[i, j]) * vv[i];
+            if (p > pmax) {
+                pmax = p;
+                imax = i;
+            }
+        }
+        if (!(pmax > T{0.0})) solver_error_msg("hd::gauss_solve(): singular matrix.");
+        if (imax != j) {
+            for (int k = 0; k < n; ++k)
+                std::swap(a[imax, k], a[j, k]);
+            std::swap(b[imax], b[j]);
+            std::swap(vv[imax], vv[j]);
+        }
+        for (int i = j + 1; i < n; ++i) {
+            T f = a[i, j] / a[j, j];
+            for (int k = j + 1; k < n; ++k)
+                a[i, k] = a[i, k] - f * a[j, k];
+            b[i] = b[i] - f * b[j];
+        }
+    }
+
+    // backward substitution
+    for (int i = n - 1; i >= 0; --i) {
+        T sum = b[i];
+        for (int k = i + 1; k < n; ++k)
+            sum = sum - a[i, k] * b[k];
+        b[i] = sum / a[i, i];
+    }
+}
+
+inline void band_lu_decomp(mdspan<double, dextents<std::size_t, 2>> ab, int kl, int ku)
+{
+    /* LU decomposition of a banded matrix without pivoting (handed back on ab)
+       row i of ab contains the elements a[i, i-kl] ... a[i, i+ku] of the matrix,
+       elements outside of the matrix are ignored
+    */
+
+    if (kl < 0 || ku < 0 || ab.extent(1) != static_cast<std::size_t>(kl + ku + 1)) {
+        solver_error_msg("hd::band_lu_decomp(): band width and storage incompatible.");
+    };
+
+    int n = ab.extent(0);
+
+    for (int k = 0; k < n; ++k) {
+        double piv = ab[k, kl];
+        if (piv == 0.)
+            solver_error_msg("hd::band_lu_decomp(): zero pivot (pivoting required).");
+        int imax = std::min(n - 1, k + kl);
+        int jmax = std::min(n - 1, k + ku);
+        for (int i = k + 1; i <= imax; ++i) {
+            double l = ab[i, k - i + kl] / piv;
+            ab[i, k - i + kl] = l;
+            for (int j = k + 1; j <= jmax; ++j)
+                ab[i, j - i + kl] -= l * ab[k, j - k + kl];
+        }
+    }
+
+} // band_lu_decomp()
+
+inline void band_lu_backsubs(mdspan<double const, dextents<std::size_t, 2>> ab, int kl, int ku,
+                             mdspan<double, dextents<std::size_t, 1>> b)
+{
+    /* solution of a*x = b with a decomposed by band_lu_decomp(), x is returned on b
+     */
+
+    if (ab.extent(1) != static_cast<std::size_t>(kl + ku + 1) || ab.extent(0) != b.extent(0)) {
+        solver_error_msg("hd::band_lu_backsubs(): band storage or right hand side size incompatible.");
+    };
+
+    int n = ab.extent(0);
+
+    for (int i = 1; i < n; ++i) {
+        double sum = b[i];
+        for (int k = std::max(0, i - kl); k < i; ++k)
+            sum -= ab[i, k - i + kl] * b[k];
+        b[i] = sum;
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = b[i];
+        int jmax = std::min(n - 1, i + ku);
+        for (int j = i + 1; j <= jmax; ++j)
+            sum -= ab[i, j - i + kl] * b[j];
+        b[i] = sum / ab[i, kl];
+    }
+
+} // band_lu_backsubs()
+
+inline void band_lu_backsubs_batch(mdspan<double const, dextents<std::size_t, 2>> ab, int kl,
+                                   int ku, mdspan<double, dextents<std::size_t, 2>> b)
+{
+    /* as band_lu_backsubs() for many right hand sides b[i, m] at once
+       (inner loops run over the contiguous index m, i.e. they can be vectorized)
+     */
+
+    if (ab.extent(1) != static_cast<std::size_t>(kl + ku + 1) || ab.extent(0) != b.extent(0)) {
+        solver_error_msg("hd::band_lu_backsubs_batch(): band storage or right hand side size incompatible.");
+    };
+
+    int n = ab.extent(0);
+    std::size_t nb = b.extent(1);
+    double* pb = b.data_handle();
+
+    for (int i = 1; i < n; ++i) {
+        double* bi = pb + i * nb;
+        for (int k = std::max(0, i - kl); k < i; ++k) {
+            double l = ab[i, k - i + kl];
+            double const* bk = pb + k * nb;
+            for (std::size_t m = 0; m < nb; ++m)
+                bi[m] -= l * bk[m];
+        }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double* bi = pb + i * nb;
+        int jmax = std::min(n - 1, i + ku);
+        for (int j = i + 1; j <= jmax; ++j) {
+            double u = ab[i, j - i + kl];
+            double const* bj = pb + j * nb;
+            for (std::size_t m = 0; m < nb; ++m)
+                bi[m] -= u * bj[m];
+        }
+        double d = 1. / ab[i, kl];
+        for (std::size_t m = 0; m < nb; ++m)
+            bi[m] *= d;
+    }
+
+} // band_lu_backsubs_batch()
+
+inline void lu_decomp_batch(mdspan<double, dextents<std::size_t, 3>> a,
+                            mdspan<int, dextents<std::size_t, 2>> perm)
+{
+    /* LU decomposition with partial pivoting of the systems a[., ., s] (handed back on a)
+       perm[k, s] is the row exchanged with row k of system s in step k
+       the pivot search is done system by system, the elimination runs over the
+       contiguous index s (vectorizable)
+     */
+
+    if (a.extent(0) != a.extent(1) || perm.extent(0) != a.extent(0) ||
+        perm.extent(1) != a.extent(2)) {
+        solver_error_msg("hd::lu_decomp_batch(): unsymmetric matrix or permutation storage incompatible.");
+    };
+
+    int n = a.extent(0);
+    std::size_t nb = a.extent(2);
+    double* pa = a.data_handle();
+    auto row = [=](int i, int j) { return pa + (std::size_t(i) * n + j) * nb; };
+
+    for (int k = 0; k < n; ++k) {
+        int* pk = perm.data_handle() + k * nb;
+        for (std::size_t s = 0; s < nb; ++s) {
+            int imax = k;
+            double amax = std::abs(row(k, k)[s]);
+            for (int i = k + 1; i < n; ++i) {
+                if (std::abs(row(i, k)[s]) > amax) {
+                    amax = std::abs(row(i, k)[s]);
+                    imax = i;
+                }
+            }
+            if (amax == 0.)
+                solver_error_msg("hd::lu_decomp_batch(): singular matrix.");
+            pk[s] = imax;
+            if (imax != k) {
+                for (int j = 0; j < n; ++j)
+                    std::swap(row(k, j)[s], row(imax, j)[s]);
+            }
+        }
+
+        double const* akk = row(k, k);
+        for (int i = k + 1; i < n; ++i) {
+            double* aik = row(i, k);
+            for (std::size_t s = 0; s < nb; ++s)
+                aik[s] /= akk[s];
+            for (int j = k + 1; j < n; ++j) {
+                double* aij = row(i, j);
+                double const* akj = row(k, j);
+                for (std::size_t s = 0; s < nb; ++s)
+                    aij[s] -= aik[s] * akj[s];
+            }
+        }
+    }
+
+} // lu_decomp_batch()
+
+inline void lu_backsubs_batch(mdspan<double const, dextents<std::size_t, 3>> a,
+                              mdspan<int const, dextents<std::size_t, 2>> perm,
+                              mdspan<double, dextents<std::size_t, 2>> b)
+{
+    /* solution of the systems decomposed by lu_decomp_batch() for rhs b[., s],
+       solutions are returned on b
+     */
+
+    if (a.extent(0) != a.extent(1) || perm.extent(0) != a.extent(0) ||
+        perm.extent(1) != a.extent(2) || b.extent(0) != a.extent(0) ||
+        b.extent(1) != a.extent(2)) {
+        solver_error_msg("hd::lu_backsubs_batch(): matrix, permutation or right hand side storage incompatible.");
+    };
+
+    int n = a.extent(0);
+    std::size_t nb = a.extent(2);
+    double const* pa = a.data_handle();
+    double* pb = b.data_handle();
+    auto row = [=](int i, int j) { return pa + (std::size_t(i) * n + j) * nb; };
+
+    for (int k = 0; k < n; ++k) {
+        int const* pk = perm.data_handle() + k * nb;
+        for (std::size_t s = 0; s < nb; ++s) {
+            if (pk[s] != k) std::swap(pb[k * nb + s], pb[pk[s] * nb + s]);
+        }
+    }
+    for (int i = 1; i < n; ++i) {
+        double* bi = pb + i * nb;
+        for (int k = 0; k < i; ++k) {
+            double const* aik = row(i, k);
+            double const* bk = pb + k * nb;
+            for (std::size_t s = 0; s < nb; ++s)
+                bi[s] -= aik[s] * bk[s];
+        }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double* bi = pb + i * nb;
+        for (int j = i + 1; j < n; ++j) {
+            double const* aij = row(i, j);
+            double const* bj = pb + j * nb;
+            for (std::size_t s = 0; s < nb; ++s)
+                bi[s] -= aij[s] * bj[s];
+        }
+        double const* aii = row(i, i);
+        for (std::size_t s = 0; s < nb; ++s)
+            bi[s] /= aii[s];
+    }
+
+} // lu_backsubs_batch()
+
 } // namespace hd
 
 #endif // HD_SOLVER_H
\ No newline at end of file
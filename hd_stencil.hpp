@@ -1,16 +1,22 @@
 #ifndef HD_STENCIL_H
 #define HD_STENCIL_H
 
-#include "hd/hd_functions.hpp" // hd::fact()
-#include "hd/hd_solver.hpp"    // hd::lu_decomp(), hd::lu_backsubs()
+#include "hd/hd_dd.hpp"     // hd::dd_real
+#include "hd/hd_solver.hpp" // hd::lu_decomp(), hd::lu_backsubs(), hd::gauss_solve()
 
 #include "mdspan/mdspan.hpp"
 
 #include "fmt/format.h"
 #include "fmt/ranges.h"
 
-#include <cmath>     // std::pow(), std::abs()
+#include <algorithm> // std::copy(), std::min(), std::max()
+#include <array>
+#include <climits>   // INT_MAX
+#include <cmath>     // std::abs()
+#include <cstddef>
+#include <span>
 #include <stdexcept> //std::invalid_argument
+#include <utility>   // std::move()
 #include <vector>
 
 namespace hd { // Namespace hd to define my types for numerical computation
@@ -20,10 +26,17 @@ enum class stencil_lhs {
     f2  // f'' terms considered to be on lhs of finite difference
 };
 
+enum class stencil_precision {
+    standard,     // moment system assembled and solved in double
+    double_double // assembled and solved in double-double arithmetic (hd::dd_real),
+                  // for many points (ill-conditioned moment systems), weights rounded to double
+};
+
 struct stencil_t {
     // after calling the ctor, the "output values" can be used
-    stencil_t(double x0, stencil_lhs lhs_t, std::vector<double> xf0, std::vector<double> xf1, std::vector<double> xf2) :
-        x0{x0}, lhs_t{lhs_t}, xf0{xf0}, xf1{xf1}, xf2{xf2}
+    stencil_t(double x0, stencil_lhs lhs_t, std::vector<double> xf0, std::vector<double> xf1, std::vector<double> xf2,
+              stencil_precision prec = stencil_precision::standard) :
+        x0{x0}, lhs_t{lhs_t}, prec{prec}, xf0{xf0}, xf1{xf1}, xf2{xf2}
     {
 
         // consistency checks
@@ -42,7 +55,7 @@ struct stencil_t {
         // fmt::print("wf1.size()={}, wf1.capacity()={}\n", wf1.size(), wf1.capacity());
         // fmt::print("wf2.size()={}, wf2.capacity()={}\n", wf2.size(), wf2.capacity());
 
-        // provide the weights, order and truncation error for further use
+        // provide the weights for further use
         calc_stencil();
     }
 
@@ -50,6 +63,7 @@ struct stencil_t {
     const double x0;         // development point of stencil
                              // (should be within or at least close to coordinates of points)
     const stencil_lhs lhs_t; // either f1 or f2 terms on lhs, all other terms considered to be on rhs
+    const stencil_precision prec; // arithmetic used to compute the weights
 
     const std::vector<double> xf0; // coordinates of points for f
     const std::vector<double> xf1; // coordinates of points for f'
@@ -60,8 +74,9 @@ struct stencil_t {
     std::vector<double> wf1; // weights of points for f'
     std::vector<double> wf2; // weights of points for f''
 
-    int order;        // order of fd stencil
-    double trunc_err; // truncation error as factor in front of highest neglected term
+    // computed on demand (not needed to apply the stencil)
+    int order() const;        // order of fd stencil
+    double trunc_err() const; // truncation error as factor in front of first neglected term
 
     // helpers for number of points
     int nf0() const { return xf0.size(); }          // number of points for f
@@ -73,98 +88,127 @@ struct stencil_t {
     void calc_stencil();
 };
 
-void stencil_t::calc_stencil()
-{
-
-    // reserve memory for matrix, permutation and rhs vector and initialize with 0.0
-    std::vector<double> mem_matrix(n() * n(), 0.0);
-    std::vector<int> mem_perm(n(), 0.0);
-    std::vector<double> mem_rhs(n(), 0.0);
+// stencil as value type with inline storage for up to max_points points in total
+// (same weights as hd::stencil_t, but no heap allocation, copy- and move-assignable,
+// i.e. suited to be stored densely in a std::vector)
+struct stencil_fixed_t {
+    static constexpr int max_points = 16;
 
-    // create views
-    mdspan matrix{mem_matrix.data(), n(), n()};
-    mdspan perm{mem_perm.data(), n()};
-    mdspan rhs{mem_rhs.data(), n()};
+    stencil_fixed_t() = default; // empty stencil (n() == 0)
+    stencil_fixed_t(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                    std::span<double const> xf1, std::span<double const> xf2);
 
-    // setup column indices (i.e. begin/end indices for f, f', f'')
-    int j0b, j0e, j1b, j1e, j2b, j2e, col;
+    double x0{0.0};
+    stencil_lhs lhs_t{stencil_lhs::f1};
 
-    // f
-    j0b = 0;
-    j0e = nf0() - 1;
-    col = j0e;
+    // coordinates and weights of points for f, f' and f''
+    std::span<double const> xf0() const { return {x.data(), std::size_t(nf[0])}; }
+    std::span<double const> xf1() const { return {x.data() + nf[0], std::size_t(nf[1])}; }
+    std::span<double const> xf2() const { return {x.data() + nf[0] + nf[1], std::size_t(nf[2])}; }
+    std::span<double const> wf0() const { return {w.data(), std::size_t(nf[0])}; }
+    std::span<double const> wf1() const { return {w.data() + nf[0], std::size_t(nf[1])}; }
+    std::span<double const> wf2() const { return {w.data() + nf[0] + nf[1], std::size_t(nf[2])}; }
 
-    // f'
-    if (nf1() > 0) {
-        j1b = col + 1;
-        j1e = col + nf1();
-        col += nf1();
-    }
+    // helpers for number of points
+    int nf0() const { return nf[0]; }
+    int nf1() const { return nf[1]; }
+    int nf2() const { return nf[2]; }
+    int n() const { return nf[0] + nf[1] + nf[2]; }
 
-    // f''
-    if (nf2() > 0) {
-        j2b = col + 1;
-        j2e = col + nf2();
-        // col += nf2(); // just needed for further extension with f'''
-    }
+    // computed on demand
+    int order() const;
+    double trunc_err() const;
 
-    // fmt::print("nf0()={}, nf1()={}, nf2()={}, n()={}\n", nf0(), nf1(), nf2(), n());
-    // fmt::print("j0b={}, j0e={}, j1b={}, j1e={}, j2b={}, j2e={}\n", j0b, j0e, j1b, j1e, j2b, j2e);
+  private:
+    std::array<int, 3> nf{0, 0, 0};
+    std::array<double, max_points> x{}; // coordinates of f, f' and f'' points (consecutive)
+    std::array<double, max_points> w{}; // corresponding weights
+};
 
-    // setup standard matrix columnwise
-    // unwanted terms of series expansion of lhs are moved to rhs (sfact)
+// bulk check of a table of stencils (e.g. in test builds): all stencils of the table
+// (stencil_t or stencil_fixed_t) are analyzed, those with an order below min_order fail
+struct stencil_table_report {
+    std::size_t nstencils{0};
+    int min_order{INT_MAX}; // min. and max. order found in table
+    int max_order{0};
+    std::vector<std::size_t> failed; // indices of stencils with order < min_order
+};
 
-    // f
-    for (int j = j0b; j <= j0e; ++j) {
-        matrix[0, j] = 1.0;
-        for (int i = 1; i < n(); ++i)
-            matrix[i, j] = std::pow(xf0[j - j0b] - x0, i) / hd::fact(i);
+template <class Table>
+stencil_table_report verify_stencil_table(Table const& table, int min_order);
+
+// weights of explicit stencils for several derivatives on the same points
+//
+//   f^(d)(x0) = sum_j w[k][j] * f(xf0[j])   for d = derivs[k]   (d = 0 ... xf0.size()-1)
+//
+// the moment matrix is assembled and LU-factored once and solved for all derivatives
+// (same weights as hd::stencil_t with a single f' or f'' point at x0 on the lhs)
+std::vector<std::vector<double>> multi_deriv_weights(double x0, std::vector<double> const& xf0,
+                                                     std::vector<int> const& derivs);
+
+namespace detail {
+
+//******************************************************************************
+// column j of a moment matrix for a point at distance dx from the development point
+//
+//   m[i, j] = 0 for i < d,   1 for i == d,   sfact * dx^(i - d) / (i - d)! for i > d
+//
+// d = 0 (f point, sfact = 1): m[i, j] = dx^i / i!. Shared by the moment systems of all
+// weights (stencils, interpolation, quadrature); powers are computed incrementally.
+//******************************************************************************
+template <class T>
+void moment_column(mdspan<T, dextents<std::size_t, 2>> m, std::size_t j, T dx, int d = 0,
+                   double sfact = 1.0)
+{
+    int n = m.extent(0);
+    for (int i = 0; i < d; ++i)
+        m[i, j] = 0.0;
+    T term{1.0};
+    m[d, j] = 1.0;
+    for (int i = d + 1; i < n; ++i) {
+        term = term * dx / double(i - d);
+        m[i, j] = term * sfact;
     }
+}
 
-    double sfact; // used to locate terms on lhs (-1.0) or on rhs (+1.0)
+//******************************************************************************
+// setup of the moment system for the weights of a stencil (shared by all stencil types)
+//
+// columns: f points, f' points, f'' points (in this order), n = total number of points
+// unwanted terms of series expansion of lhs are moved to rhs (sfact), the last equation
+// is replaced by the normalization condition (sum of coefficients on lhs = 1)
+// powers are computed incrementally: (x - x0)^i / i! = (x - x0)^(i-1) / (i-1)! * (x - x0) / i
+//******************************************************************************
+template <class T>
+void assemble_moment_system(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                            std::span<double const> xf1, std::span<double const> xf2,
+                            mdspan<T, dextents<std::size_t, 2>> matrix,
+                            mdspan<T, dextents<std::size_t, 1>> rhs)
+{
+    int nf0 = xf0.size(), nf1 = xf1.size(), nf2 = xf2.size();
+    int n = nf0 + nf1 + nf2;
 
-    // f'
-    if (nf1() > 0) {
-        if (lhs_t == stencil_lhs::f1) {
-            // put terms on lhs
-            sfact = -1.0;
-        }
-        else {
-            // put terms on rhs
-            sfact = 1.0;
-        }
-        for (int j = j1b; j <= j1e; ++j) {
-            matrix[0, j] = 0.0;
-            matrix[1, j] = 1.0;
-            for (int i = 2; i < n(); ++i)
-                matrix[i, j] = sfact * std::pow(xf1[j - j1b] - x0, i - 1) / hd::fact(i - 1);
-        }
-    }
+    // fill column j with (x - x0)^(i - d) / (i - d)! for i >= d (0 for i < d, 1 for i == d)
+    auto fill_column = [&](int j, double x, int d, double sfact) {
+        moment_column(matrix, j, T(x) - T(x0), d, sfact);
+    };
 
+    // f
+    for (int j = 0; j < nf0; ++j)
+        fill_column(j, xf0[j], 0, 1.0);
+    // f' (put terms on lhs (-1.0) or on rhs (+1.0))
+    for (int j = 0; j < nf1; ++j)
+        fill_column(nf0 + j, xf1[j], 1, lhs_t == stencil_lhs::f1 ? -1.0 : 1.0);
     // f''
-    if (nf2() > 0) {
-        if (lhs_t == stencil_lhs::f2) {
-            // put terms on lhs
-            sfact = -1.0;
-        }
-        else {
-            // put terms on rhs
-            sfact = 1.0;
-        }
-        for (int j = j2b; j <= j2e; ++j) {
-            matrix[0, j] = 0.0;
-            matrix[1, j] = 0.0;
-            matrix[2, j] = 1.0;
-            for (int i = 3; i < n(); ++i)
-                matrix[i, j] = sfact * std::pow(xf2[j - j2b] - x0, i - 2) / hd::fact(i - 2);
-        }
-    }
+    for (int j = 0; j < nf2; ++j)
+        fill_column(nf0 + nf1 + j, xf2[j], 2, lhs_t == stencil_lhs::f2 ? -1.0 : 1.0);
 
     // setup rhs
+    for (int i = 0; i < n; ++i)
+        rhs[i] = 0.0;
     if (lhs_t == stencil_lhs::f1) {
         rhs[1] = 1.0;
     }
-
     if (lhs_t == stencil_lhs::f2) {
         rhs[2] = 1.0;
     }
@@ -173,27 +217,117 @@ void stencil_t::calc_stencil()
     //                i.e. set coefficients of primary derivative to 1.0 in the last equation (normalization)
     //                and set them to 0.0 in the corresponding matrix line
     //                (remove them from the rhs of the standard system)
-    for (int j = 0; j < n(); ++j)
-        matrix[n() - 1, j] = 0.0;
+    for (int j = 0; j < n; ++j)
+        matrix[n - 1, j] = 0.0;
 
-    rhs[n() - 1] = 1.0;
+    rhs[n - 1] = 1.0;
 
     if (lhs_t == stencil_lhs::f1) {
-        for (int j = j1b; j <= j1e; ++j) {
-            matrix[n() - 1, j] = 1.0;
+        for (int j = nf0; j < nf0 + nf1; ++j) {
+            matrix[n - 1, j] = 1.0;
             matrix[1, j] = 0.0;
         }
     }
     if (lhs_t == stencil_lhs::f2) {
-        for (int j = j2b; j <= j2e; ++j) {
-            matrix[n() - 1, j] = 1.0;
+        for (int j = nf0 + nf1; j < n; ++j) {
+            matrix[n - 1, j] = 1.0;
             matrix[2, j] = 0.0;
         }
     }
+}
 
-    // solve system
-    hd::lu_decomp(matrix, perm);
-    hd::lu_backsubs(matrix, perm, rhs); // weights are now on rhs
+struct stencil_analysis {
+    int order;
+    double trunc_err;
+};
+
+//******************************************************************************
+// order and truncation error of a stencil with given weights
+//
+// The truncation error is the first moment i of the series expansion that is not
+// matched by the stencil (terms on the lhs with negative sign):
+//
+//   T_i = sum wf0 dx^i/i! - sum_lhs w dx^(i-d)/(i-d)! + sum_rhs w dx^(i-d)/(i-d)!
+//
+// The moments i < n-1 vanish by construction. T_i is considered nonzero, if it is large
+// compared to the rounding error of the sum (i.e. independent of the scale of dx).
+// order = i - (derivative on lhs); if no nonzero moment is found up to i = n+2, this
+// (lower) bound of the order is returned with trunc_err = 0.
+//******************************************************************************
+inline stencil_analysis analyze_stencil(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                                        std::span<double const> xf1, std::span<double const> xf2,
+                                        std::span<double const> wf0, std::span<double const> wf1,
+                                        std::span<double const> wf2)
+{
+    int n = xf0.size() + xf1.size() + xf2.size();
+    int d = (lhs_t == stencil_lhs::f1) ? 1 : 2;
+    double sfact1 = (lhs_t == stencil_lhs::f1) ? -1.0 : 1.0;
+    double sfact2 = (lhs_t == stencil_lhs::f2) ? -1.0 : 1.0;
+    constexpr double eps = 1.0e-8;
+
+    // contribution of the points of derivative k to moment i (term: dx^(i-k)/(i-k)!)
+    auto moment = [&](std::span<double const> x, std::span<double const> w, int i, int k,
+                      double sfact, double& sum, double& mag) {
+        if (i < k) return;
+        for (std::size_t j = 0; j < x.size(); ++j) {
+            double dx = x[j] - x0;
+            double term = 1.0;
+            for (int p = 1; p <= i - k; ++p)
+                term *= dx / p;
+            sum += sfact * w[j] * term;
+            mag += std::abs(w[j] * term);
+        }
+    };
+
+    int imax = n + 2;
+    for (int i = n - 1; i <= imax; ++i) {
+        double sum = 0.0, mag = 0.0;
+        moment(xf0, wf0, i, 0, 1.0, sum, mag);
+        moment(xf1, wf1, i, 1, sfact1, sum, mag);
+        moment(xf2, wf2, i, 2, sfact2, sum, mag);
+        if (std::abs(sum) > eps * mag) return {i - d, sum};
+    }
+    return {imax - d, 0.0};
+}
+
+} // namespace detail
+
+void stencil_t::calc_stencil()
+{
+
+    // reserve memory for matrix, permutation and rhs vector and initialize with 0.0
+    std::vector<double> mem_matrix(n() * n(), 0.0);
+    std::vector<int> mem_perm(n(), 0.0);
+    std::vector<double> mem_rhs(n(), 0.0);
+
+    // create views
+    mdspan matrix{mem_matrix.data(), n(), n()};
+    mdspan perm{mem_perm.data(), n()};
+    mdspan rhs{mem_rhs.data(), n()};
+
+    // setup column indices (i.e. begin/end indices for f, f', f'')
+    int j0b = 0, j0e = nf0() - 1;
+    int j1b = nf0(), j1e = nf0() + nf1() - 1;
+    int j2b = nf0() + nf1(), j2e = n() - 1;
+
+    if (prec == stencil_precision::double_double) {
+        // assembly and solution in double-double arithmetic, weights rounded to double
+        std::vector<dd_real> mem_matrix_dd(n() * n()), mem_rhs_dd(n());
+        mdspan matrix_dd{mem_matrix_dd.data(), n(), n()};
+        mdspan rhs_dd{mem_rhs_dd.data(), n()};
+
+        detail::assemble_moment_system(x0, lhs_t, xf0, xf1, xf2, matrix_dd, rhs_dd);
+        hd::gauss_solve(matrix_dd, rhs_dd);
+        for (int j = 0; j < n(); ++j)
+            rhs[j] = to_double(rhs_dd[j]);
+    }
+    else {
+        detail::assemble_moment_system(x0, lhs_t, xf0, xf1, xf2, matrix, rhs);
+
+        // solve system
+        hd::lu_decomp(matrix, perm);
+        hd::lu_backsubs(matrix, perm, rhs); // weights are now on rhs
+    }
 
     // assign weights to output vectors
     // f
@@ -209,55 +343,102 @@ void stencil_t::calc_stencil()
         for (int j = j2b; j <= j2e; ++j)
             wf2.push_back(rhs[j]);
     }
+}
+
+inline int stencil_t::order() const
+{
+    return detail::analyze_stencil(x0, lhs_t, xf0, xf1, xf2, wf0, wf1, wf2).order;
+}
+
+inline double stencil_t::trunc_err() const
+{
+    return detail::analyze_stencil(x0, lhs_t, xf0, xf1, xf2, wf0, wf1, wf2).trunc_err;
+}
+
+inline stencil_fixed_t::stencil_fixed_t(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                                        std::span<double const> xf1,
+                                        std::span<double const> xf2) :
+    x0{x0}, lhs_t{lhs_t}, nf{int(xf0.size()), int(xf1.size()), int(xf2.size())}
+{
+    // consistency checks (as for stencil_t)
+    if ((nf1() == 0 && nf2() == 0) || n() < 3 || n() > max_points ||
+        (nf1() == 0 && lhs_t == stencil_lhs::f1) ||
+        (nf2() == 0 && lhs_t == stencil_lhs::f2)) {
+        throw std::invalid_argument("Inconsistent specification of stencil in ctor of hd::stencil_fixed_t.");
+    }
+    std::copy(xf0.begin(), xf0.end(), x.begin());
+    std::copy(xf1.begin(), xf1.end(), x.begin() + nf0());
+    std::copy(xf2.begin(), xf2.end(), x.begin() + nf0() + nf1());
+
+    // moment system on the stack; the weights are the solution
+    std::array<double, max_points * max_points> mem_matrix;
+    std::array<int, max_points> mem_perm;
+    std::array<double, max_points> mem_scratch;
+    std::size_t nn = n();
+    mdspan matrix{mem_matrix.data(), nn, nn};
+    mdspan<int, dextents<std::size_t, 1>> perm{mem_perm.data(), nn};
+    mdspan<double, dextents<std::size_t, 1>> rhs{w.data(), nn};
+
+    detail::assemble_moment_system(x0, lhs_t, xf0, xf1, xf2, matrix, rhs);
+    hd::lu_decomp(matrix, perm, mdspan{mem_scratch.data(), nn});
+    hd::lu_backsubs(matrix, perm, rhs);
+}
 
-    // compute order and truncation error
+inline int stencil_fixed_t::order() const
+{
+    return detail::analyze_stencil(x0, lhs_t, xf0(), xf1(), xf2(), wf0(), wf1(), wf2()).order;
+}
 
-    // f
-    for (int i = nf0(); i <= n(); ++i) {
-        double sumte = 0.0;
-        for (int j = j0b; j <= j0e; ++j)
-            sumte += std::pow(xf0[j - j0b] - x0, i) / hd::fact(i) * rhs[j];
-
-        // f'
-        if (nf1() > 0) {
-            if (lhs_t == stencil_lhs::f1) {
-                // put terms on lhs
-                sfact = -1.0;
-            }
-            else {
-                // put terms on rhs
-                sfact = 1.0;
-            }
-            for (int j = j1b; j <= j1e; ++j)
-                sumte += std::pow(xf1[j - j1b] - x0, i - 1) / hd::fact(i - 1) * rhs[j];
-        }
+inline double stencil_fixed_t::trunc_err() const
+{
+    return detail::analyze_stencil(x0, lhs_t, xf0(), xf1(), xf2(), wf0(), wf1(), wf2()).trunc_err;
+}
+
+template <class Table>
+stencil_table_report verify_stencil_table(Table const& table, int min_order)
+{
+    stencil_table_report rep;
+    for (auto const& s : table) {
+        int order = s.order();
+        rep.min_order = std::min(rep.min_order, order);
+        rep.max_order = std::max(rep.max_order, order);
+        if (order < min_order) rep.failed.push_back(rep.nstencils);
+        ++rep.nstencils;
+    }
+    return rep;
+}
 
-        // f''
-        if (nf2() > 0) {
-            if (lhs_t == stencil_lhs::f2) {
-                // put terms on lhs
-                sfact = -1.0;
-            }
-            else {
-                // put terms on rhs
-                sfact = 1.0;
-            }
-            for (int j = j2b; j <= j2e; ++j)
-                sumte += std::pow(xf2[j - j2b] - x0, i - 2) / hd::fact(i - 2) * rhs[j];
+inline std::vector<std::vector<double>> multi_deriv_weights(double x0,
+                                                            std::vector<double> const& xf0,
+                                                            std::vector<int> const& derivs)
+{
+    int n = xf0.size();
+    for (int d : derivs) {
+        if (d < 0 || d >= n) {
+            throw std::invalid_argument("hd::multi_deriv_weights(): derivative not supported by number of points.");
         }
+    }
 
-        double eps = 1.0e-6;
-        if (std::abs(sumte) > eps) {
-            trunc_err = sumte;
+    // moment matrix m[i, j] = (xf0[j] - x0)^i / i!
+    std::vector<double> mem_matrix(n * n);
+    std::vector<int> mem_perm(n);
+    mdspan<double, dextents<std::size_t, 2>> matrix{mem_matrix.data(), n, n};
+    mdspan perm{mem_perm.data(), n};
 
-            if (lhs_t == stencil_lhs::f1) {
-                order = i - 1;
-            }
-            if (lhs_t == stencil_lhs::f2) {
-                order = i - 2;
-            }
-        }
+    for (int j = 0; j < n; ++j)
+        detail::moment_column(matrix, j, xf0[j] - x0);
+    hd::lu_decomp(matrix, perm);
+
+    // one backsubstitution per derivative (rhs: unit vector of the derivative)
+    std::vector<std::vector<double>> w;
+    w.reserve(derivs.size());
+    for (int d : derivs) {
+        std::vector<double> rhs(n, 0.0);
+        rhs[d] = 1.0;
+        hd::lu_backsubs(matrix, perm, mdspan{rhs.data(), n});
+        w.push_back(std::move(rhs));
     }
+    return w;
 }
 
 } // namespace hd
@@ -0,0 +1,195 @@
+#ifndef HD_STENCIL_AMR_H
+#define HD_STENCIL_AMR_H
+
+// adaptive 1D grid with explicit derivative stencils (f' or f'') of np points per grid point
+//
+// The stencil of point i uses the points i + rel[i] ... i + rel[i] + np - 1 (centered,
+// one-sided at the boundaries). As the first point is stored relative to i, stencils
+// remain valid when points are inserted or removed elsewhere: after refining or coarsening
+// a region, the storage (contiguous, np weights per point) is spliced and only stencils
+// whose support intersects the changed region are rebuilt.
+//
+// Usage:
+//
+// hd::amr_grid1d g(x, hd::stencil_lhs::f1, 5);
+// hd::amr_report rep = g.refine(0.2, 0.4);     // midpoints inserted in [0.2, 0.4]
+// fmt::print("rebuilt {} of {} stencils\n", rep.rebuilt, g.size());
+// g.apply(f, df);                              // f, df: values at g.x()
+
+#include "hd/hd_stencil.hpp" // hd::stencil_fixed_t
+
+#include <algorithm> // std::clamp(), std::lower_bound(), std::upper_bound(), std::max(), std::min()
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+// statistics of one adaptation step
+struct amr_report {
+    std::size_t inserted{0}; // points inserted
+    std::size_t removed{0};  // points removed
+    std::size_t rebuilt{0};  // stencils computed
+};
+
+class amr_grid1d {
+  public:
+    amr_grid1d(std::vector<double> x, stencil_lhs lhs_t = stencil_lhs::f1, int np = 5);
+
+    // insert the midpoints of all intervals within [a, b]
+    amr_report refine(double a, double b);
+    // remove every second point strictly inside (a, b)
+    amr_report coarsen(double a, double b);
+
+    // df = derivative of f (values at x())
+    void apply(std::span<double const> f, std::span<double> df) const;
+
+    std::span<double const> x() const { return xs; }
+    std::size_t size() const { return xs.size(); }
+
+  private:
+    std::vector<double> xs;
+    stencil_lhs lhs_t;
+    int np;
+    std::vector<int> rel;  // first point of stencil relative to point
+    std::vector<double> w; // np weights per point
+
+    int first_rel(std::size_t i) const; // relative first point for current grid size
+    void build(std::size_t i);
+    std::size_t rebuild(std::size_t lo, std::size_t hi); // stencils affected by [lo, hi]
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline amr_grid1d::amr_grid1d(std::vector<double> x, stencil_lhs lhs_t, int np) :
+    xs{std::move(x)}, lhs_t{lhs_t}, np{np}
+{
+    if (np < 3 || np + 1 > stencil_fixed_t::max_points || xs.size() < std::size_t(np)) {
+        throw std::invalid_argument("Inconsistent specification in ctor of hd::amr_grid1d.");
+    }
+    for (std::size_t i = 0; i + 1 < xs.size(); ++i) {
+        if (!(xs[i + 1] > xs[i])) {
+            throw std::invalid_argument("hd::amr_grid1d: grid not strictly increasing.");
+        }
+    }
+    rel.resize(xs.size());
+    w.resize(xs.size() * np);
+    for (std::size_t i = 0; i < xs.size(); ++i)
+        build(i);
+}
+
+inline int amr_grid1d::first_rel(std::size_t i) const
+{
+    int n = xs.size(), ii = i;
+    return std::clamp(ii - np / 2, 0, n - np) - ii;
+}
+
+inline void amr_grid1d::build(std::size_t i)
+{
+    rel[i] = first_rel(i);
+    double const* xf0 = xs.data() + i + rel[i];
+    double xl[1] = {xs[i]};
+    stencil_fixed_t s = (lhs_t == stencil_lhs::f1)
+                            ? stencil_fixed_t(xs[i], lhs_t, {xf0, std::size_t(np)}, xl, {})
+                            : stencil_fixed_t(xs[i], lhs_t, {xf0, std::size_t(np)}, {}, xl);
+    for (int k = 0; k < np; ++k)
+        w[i * np + k] = s.wf0()[k];
+}
+
+//******************************************************************************
+// rebuild all stencils that contain a point of [lo, hi] (new indices) or whose relative
+// first point changed (near the boundaries)
+//******************************************************************************
+inline std::size_t amr_grid1d::rebuild(std::size_t lo, std::size_t hi)
+{
+    std::size_t n = xs.size(), cnt = 0;
+    std::size_t i0 = lo > std::size_t(np) ? lo - np : 0;
+    std::size_t i1 = std::min(n, hi + np + 1);
+    for (std::size_t i = i0; i < i1; ++i) {
+        std::size_t f = i + first_rel(i);
+        bool touches = f <= hi && f + np > lo;
+        if (touches || rel[i] != first_rel(i)) {
+            build(i);
+            ++cnt;
+        }
+    }
+    return cnt;
+}
+
+inline amr_report amr_grid1d::refine(double a, double b)
+{
+    amr_report rep;
+    std::size_t ia = std::lower_bound(xs.begin(), xs.end(), a) - xs.begin();
+    std::size_t ib = std::upper_bound(xs.begin(), xs.end(), b) - xs.begin(); // past last
+    if (ib <= ia + 1) return rep; // no interval inside [a, b]
+
+    // new coordinates of [ia, ib): old points and midpoints
+    std::vector<double> xn;
+    for (std::size_t i = ia; i < ib; ++i) {
+        xn.push_back(xs[i]);
+        if (i + 1 < ib) xn.push_back(0.5 * (xs[i] + xs[i + 1]));
+    }
+    rep.inserted = xn.size() - (ib - ia);
+
+    // splice: replace the range [ia, ib) (stencils of the range rebuilt below)
+    xs.erase(xs.begin() + ia, xs.begin() + ib);
+    xs.insert(xs.begin() + ia, xn.begin(), xn.end());
+    rel.insert(rel.begin() + ia, rep.inserted, 0);
+    w.insert(w.begin() + ia * np, rep.inserted * np, 0.0);
+
+    rep.rebuilt = rebuild(ia, ia + xn.size() - 1);
+    return rep;
+}
+
+inline amr_report amr_grid1d::coarsen(double a, double b)
+{
+    amr_report rep;
+    std::size_t ia = std::upper_bound(xs.begin(), xs.end(), a) - xs.begin(); // first inside
+    std::size_t ib = std::lower_bound(xs.begin(), xs.end(), b) - xs.begin(); // past last inside
+    if (ib <= ia) return rep;
+
+    // remove points ia, ia+2, ... of the inner points (ia-1 is kept, exists if a >= x[0])
+    std::size_t keep = 0;
+    for (std::size_t i = ia; i < ib; ++i) {
+        if ((i - ia) % 2 == 1 || xs.size() - rep.removed <= std::size_t(np)) {
+            std::size_t k = ia + keep++;
+            xs[k] = xs[i];
+            rel[k] = rel[i];
+            std::copy(w.begin() + i * np, w.begin() + (i + 1) * np, w.begin() + k * np);
+        }
+        else {
+            ++rep.removed;
+        }
+    }
+    xs.erase(xs.begin() + ia + keep, xs.begin() + ib);
+    rel.erase(rel.begin() + ia + keep, rel.begin() + ib);
+    w.erase(w.begin() + (ia + keep) * np, w.begin() + ib * np);
+
+    // changed region: the remaining points and their neighbours
+    std::size_t lo = ia > 0 ? ia - 1 : 0;
+    std::size_t hi = std::min(xs.size() - 1, ia + keep);
+    rep.rebuilt = rebuild(lo, hi);
+    return rep;
+}
+
+inline void amr_grid1d::apply(std::span<double const> f, std::span<double> df) const
+{
+    if (f.size() != xs.size() || df.size() != xs.size()) {
+        throw std::invalid_argument("hd::amr_grid1d::apply(): sizes incompatible.");
+    }
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        double const* fi = f.data() + i + rel[i];
+        double const* wi = w.data() + i * np;
+        double sum = 0.0;
+        for (int k = 0; k < np; ++k)
+            sum += wi[k] * fi[k];
+        df[i] = sum;
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_AMR_H
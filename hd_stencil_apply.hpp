@@ -0,0 +1,228 @@
+#ifndef HD_STENCIL_APPLY_H
+#define HD_STENCIL_APPLY_H
+
+// application of explicit stencils to fields on uniform grids
+//
+// Usage:
+//
+// 1.) convert explicit stencils (one lhs point at x0) built with the grid coordinates
+//     into integer grid offsets and weights
+//
+// hd::stencil_weights d1{hd::stencil_t(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {}), h};
+// hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2, {-h, 0.0, h}, {}, {0.0}), h};
+//
+// 2.) describe every requested output as a sum of stencils along axes of the field
+//     and compute all outputs in a single sweep over the input field
+//
+// std::vector<hd::fused_output> out{{f_x, {{0, d1}}},
+//                                   {f_xx, {{0, d2}}},
+//                                   {lap, {{0, d2}, {1, d2}, {2, d2}}}};
+// hd::apply_fused(f, out);
+//
+// 1D or 2D fields can be used as 3D views with unit extents in the leading axes.
+
+#include "hd/hd_stencil.hpp" // hd::stencil_t
+
+#include <algorithm> // std::max(), std::sort()
+#include <array>
+#include <cmath>     // std::lround(), std::abs()
+#include <cstddef>   // std::size_t, std::ptrdiff_t
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+// 3D fields in row major layout (last index is contiguous in memory)
+using field3d_t = mdspan<double, dextents<std::size_t, 3>>;
+using cfield3d_t = mdspan<double const, dextents<std::size_t, 3>>;
+
+// explicit stencil on a uniform grid: f^(d)[i] = sum_j weight[j] * f[i + offset[j]]
+struct stencil_weights {
+    stencil_weights() = default;
+    stencil_weights(std::vector<int> offset, std::vector<double> weight);
+
+    // take over the weights of an explicit stencil_t (exactly one lhs point located at x0,
+    // no derivative terms on the rhs); h is the grid spacing used for the coordinates of s
+    stencil_weights(stencil_t const& s, double h);
+
+    std::vector<int> offset;    // offsets of points relative to the development point
+    std::vector<double> weight; // weights of points
+
+    int size() const { return offset.size(); } // number of points
+    int radius() const;                        // max. distance of a point from the center
+};
+
+// stencil applied along a given axis of a field
+struct axis_stencil {
+    std::size_t axis;
+    stencil_weights w;
+};
+
+// output field of a fused pass: out = sum of all terms applied to the input field
+struct fused_output {
+    field3d_t out;
+    std::vector<axis_stencil> terms;
+};
+
+// point of a sum of stencils: offsets in all axes and weight
+struct stencil_tap {
+    std::array<int, 3> d;
+    double w;
+};
+
+// merged points of a sum of stencils in memory order (shared points combined)
+std::vector<stencil_tap> merge_terms(std::span<axis_stencil const> terms);
+// max. stencil radius of a sum of stencils in each axis
+std::array<std::size_t, 3> terms_radius(std::span<axis_stencil const> terms);
+
+void apply_fused(cfield3d_t f, std::span<fused_output const> outputs);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline stencil_weights::stencil_weights(std::vector<int> offset, std::vector<double> weight) :
+    offset{offset}, weight{weight}
+{
+    if (offset.size() != weight.size() || offset.empty()) {
+        throw std::invalid_argument("Inconsistent offsets and weights in ctor of hd::stencil_weights.");
+    }
+}
+
+inline stencil_weights::stencil_weights(stencil_t const& s, double h)
+{
+    constexpr double eps = 1.0e-8; // tolerance of point locations relative to h
+
+    // the stencil must be explicit: lhs consists of the single point x0 only
+    bool explicit_f1 = s.lhs_t == stencil_lhs::f1 && s.nf1() == 1 && s.nf2() == 0 &&
+                       std::abs(s.xf1[0] - s.x0) <= eps * h;
+    bool explicit_f2 = s.lhs_t == stencil_lhs::f2 && s.nf2() == 1 && s.nf1() == 0 &&
+                       std::abs(s.xf2[0] - s.x0) <= eps * h;
+    if (!(explicit_f1 || explicit_f2) || h <= 0.0) {
+        throw std::invalid_argument("hd::stencil_weights: stencil is not explicit or h <= 0.");
+    }
+    double wlhs = explicit_f1 ? s.wf1[0] : s.wf2[0]; // == 1.0 due to normalization
+
+    for (int j = 0; j < s.nf0(); ++j) {
+        double x = (s.xf0[j] - s.x0) / h;
+        long ix = std::lround(x);
+        if (std::abs(x - ix) > eps) {
+            throw std::invalid_argument("hd::stencil_weights: stencil point not located on grid.");
+        }
+        offset.push_back(ix);
+        weight.push_back(s.wf0[j] / wlhs);
+    }
+}
+
+inline int stencil_weights::radius() const
+{
+    int r = 0;
+    for (int o : offset)
+        r = std::max(r, std::abs(o));
+    return r;
+}
+
+inline std::vector<stencil_tap> merge_terms(std::span<axis_stencil const> terms)
+{
+    std::vector<stencil_tap> taps;
+    for (auto const& t : terms) {
+        if (t.axis > 2) {
+            throw std::invalid_argument("hd::merge_terms(): invalid axis.");
+        }
+        for (int j = 0; j < t.w.size(); ++j) {
+            stencil_tap tp{{0, 0, 0}, t.w.weight[j]};
+            tp.d[t.axis] = t.w.offset[j];
+            taps.push_back(tp);
+        }
+    }
+    // lexicographic order of offsets == memory order for row major fields
+    std::sort(taps.begin(), taps.end(),
+              [](stencil_tap const& a, stencil_tap const& b) { return a.d < b.d; });
+    std::size_t m = 0;
+    for (std::size_t j = 1; j < taps.size(); ++j) {
+        if (taps[j].d == taps[m].d)
+            taps[m].w += taps[j].w;
+        else
+            taps[++m] = taps[j];
+    }
+    if (!taps.empty()) taps.resize(m + 1);
+    return taps;
+}
+
+inline std::array<std::size_t, 3> terms_radius(std::span<axis_stencil const> terms)
+{
+    std::array<std::size_t, 3> r{0, 0, 0};
+    for (auto const& t : terms) {
+        if (t.axis > 2) {
+            throw std::invalid_argument("hd::terms_radius(): invalid axis.");
+        }
+        r[t.axis] = std::max(r[t.axis], static_cast<std::size_t>(t.w.radius()));
+    }
+    return r;
+}
+
+//******************************************************************************
+// compute all outputs in a single sweep over f
+//
+// The terms of each output are merged into one list of (memory offset, weight) pairs,
+// i.e. shared points like the center of a laplacian are read only once. The input rows
+// needed for one row of output stay cache resident while all outputs are computed.
+//
+// Only points with full stencil support (for all outputs) are written. Points closer
+// to the boundary than the max. stencil radius of an axis are left untouched and are
+// to be filled in by the boundary closures of the caller.
+//******************************************************************************
+inline void apply_fused(cfield3d_t f, std::span<fused_output const> outputs)
+{
+    std::size_t n[3] = {f.extent(0), f.extent(1), f.extent(2)};
+    std::ptrdiff_t stride[3] = {static_cast<std::ptrdiff_t>(n[1] * n[2]),
+                                static_cast<std::ptrdiff_t>(n[2]), 1};
+
+    // radius of support in each axis and merged taps for each output
+    std::size_t r[3] = {0, 0, 0};
+    std::vector<std::vector<std::pair<std::ptrdiff_t, double>>> taps(outputs.size());
+
+    for (std::size_t o = 0; o < outputs.size(); ++o) {
+        if (outputs[o].out.extent(0) != n[0] || outputs[o].out.extent(1) != n[1] ||
+            outputs[o].out.extent(2) != n[2] || outputs[o].terms.empty()) {
+            throw std::invalid_argument("hd::apply_fused(): output extents incompatible or no terms.");
+        }
+        auto ro = terms_radius(outputs[o].terms);
+        for (int a = 0; a < 3; ++a)
+            r[a] = std::max(r[a], ro[a]);
+        for (auto const& tp : merge_terms(outputs[o].terms))
+            taps[o].emplace_back(tp.d[0] * stride[0] + tp.d[1] * stride[1] + tp.d[2], tp.w);
+    }
+
+    for (int a = 0; a < 3; ++a) {
+        if (n[a] < 2 * r[a] + 1) return; // no point with full support
+    }
+
+    double const* src = f.data_handle();
+
+    for (std::size_t i = r[0]; i < n[0] - r[0]; ++i) {
+        for (std::size_t j = r[1]; j < n[1] - r[1]; ++j) {
+            std::ptrdiff_t row = i * stride[0] + j * stride[1];
+            for (std::size_t o = 0; o < outputs.size(); ++o) {
+                double* dst = outputs[o].out.data_handle() + row;
+                double const* s0 = src + row + taps[o][0].first;
+                double w0 = taps[o][0].second;
+                // contiguous inner loops (vectorizable)
+                for (std::size_t k = r[2]; k < n[2] - r[2]; ++k)
+                    dst[k] = w0 * s0[k];
+                for (std::size_t t = 1; t < taps[o].size(); ++t) {
+                    double const* s = src + row + taps[o][t].first;
+                    double w = taps[o][t].second;
+                    for (std::size_t k = r[2]; k < n[2] - r[2]; ++k)
+                        dst[k] += w * s[k];
+                }
+            }
+        }
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_APPLY_H
@@ -0,0 +1,206 @@
+#ifndef HD_STENCIL_AUTOTUNE_H
+#define HD_STENCIL_AUTOTUNE_H
+
+// autotuning of the blocking parameters of hd::advance_blocked()
+//
+// The best tile sizes, time steps per block and thread count depend on the machine (cache
+// sizes, cores), the stencils and the shape of the field. On first use for a problem the
+// candidates are timed (hd::stop_watch) on a copy of the field and the fastest one is
+// stored in a small cache file keyed by CPU model (/proc/cpuinfo), field extents, stencil
+// radius and number of stencil points. Later runs reload the cache file and skip the
+// benchmark.
+//
+// Cache file: one line per problem "<key>\t<steps> <tile0> <tile1> <threads>"
+//
+// Usage:
+//
+// hd::block_autotuner tuner;                        // loads hd_autotune.cache (if present)
+// hd::time_block_t blk = tuner.tune(u, lap, dt);    // cached or benchmarked
+// hd::advance_blocked(u, work, lap, dt, nsteps, blk);
+
+#include "hd/hd_parallel.hpp"          // hd::default_threads()
+#include "hd/hd_stencil_timeblock.hpp" // hd::advance_blocked(), hd::time_block_t
+#include "hd/hd_stop_watch.hpp"        // hd::stop_watch
+
+#include <algorithm> // std::min(), std::max(), std::max_element(), std::sort(), std::unique()
+#include <array>
+#include <cstddef>
+#include <cstdio>  // std::rename()
+#include <fstream>
+#include <limits>
+#include <map>
+#include <span>
+#include <sstream>
+#include <stdexcept> // std::invalid_argument
+#include <string>
+#include <utility> // std::move()
+#include <vector>
+
+namespace hd {
+
+struct autotune_param {
+    std::string cache_file{"hd_autotune.cache"};
+    std::vector<std::size_t> tiles{8, 16, 32, 64}; // candidate tile sizes (axes 0 and 1)
+    std::vector<std::size_t> steps{1, 2, 4, 8};    // candidate time steps per block
+    std::vector<unsigned> threads{};               // candidate threads (empty: 1 and all)
+    int repeats{3};                                // timings per candidate (min. is used)
+};
+
+// model name of the first cpu in /proc/cpuinfo ("unknown" if not available)
+std::string cpu_model();
+
+class block_autotuner {
+  public:
+    explicit block_autotuner(autotune_param par = {});
+
+    // blocking parameters for the field u and the stencils terms (benchmarked on a copy of
+    // u with time step dt if not cached yet; new results are written to the cache file)
+    time_block_t tune(cfield3d_t u, std::span<axis_stencil const> terms, double dt);
+
+    std::string key(std::array<std::size_t, 3> n, std::span<axis_stencil const> terms) const;
+    std::size_t benchmarks() const { return nbench; } // candidates timed so far
+
+  private:
+    autotune_param par;
+    std::string cpu;
+    std::map<std::string, time_block_t> cache;
+    std::size_t nbench{0};
+
+    void load();
+    void save() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline std::string cpu_model()
+{
+    std::ifstream f("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            auto p = line.find(':');
+            if (p == std::string::npos) break;
+            auto b = line.find_first_not_of(" \t", p + 1);
+            return b == std::string::npos ? "unknown" : line.substr(b);
+        }
+    }
+    return "unknown";
+}
+
+inline block_autotuner::block_autotuner(autotune_param par) : par{std::move(par)}, cpu{cpu_model()}
+{
+    if (this->par.tiles.empty() || this->par.steps.empty() || this->par.repeats < 1) {
+        throw std::invalid_argument("Inconsistent specification in ctor of hd::block_autotuner.");
+    }
+    if (this->par.threads.empty()) {
+        this->par.threads = {1};
+        if (default_threads() > 1) this->par.threads.push_back(default_threads());
+    }
+    for (char& c : cpu)
+        if (c == '\t' || c == '\n') c = ' ';
+    load();
+}
+
+inline std::string block_autotuner::key(std::array<std::size_t, 3> n,
+                                        std::span<axis_stencil const> terms) const
+{
+    auto r = terms_radius(terms);
+    std::ostringstream os;
+    os << cpu << '|' << n[0] << 'x' << n[1] << 'x' << n[2] << '|' << r[0] << ',' << r[1] << ','
+       << r[2] << '|' << merge_terms(terms).size();
+    return os.str();
+}
+
+inline void block_autotuner::load()
+{
+    std::ifstream f(par.cache_file);
+    std::string line;
+    while (std::getline(f, line)) {
+        auto p = line.find('\t');
+        if (p == std::string::npos) continue; // malformed lines are ignored
+        std::istringstream is(line.substr(p + 1));
+        time_block_t blk;
+        if (is >> blk.steps >> blk.tile0 >> blk.tile1 >> blk.threads && blk.steps > 0 &&
+            blk.tile0 > 0 && blk.tile1 > 0) {
+            cache[line.substr(0, p)] = blk;
+        }
+    }
+}
+
+//******************************************************************************
+// the complete cache is written to a temporary file which replaces the cache file
+//******************************************************************************
+inline void block_autotuner::save() const
+{
+    std::string tmp = par.cache_file + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        for (auto const& [k, blk] : cache)
+            f << k << '\t' << blk.steps << ' ' << blk.tile0 << ' ' << blk.tile1 << ' '
+              << blk.threads << '\n';
+        if (!f) return; // cache is optional: tuning is repeated in the next run
+    }
+    std::rename(tmp.c_str(), par.cache_file.c_str());
+}
+
+inline time_block_t block_autotuner::tune(cfield3d_t u, std::span<axis_stencil const> terms,
+                                          double dt)
+{
+    std::array<std::size_t, 3> n{u.extent(0), u.extent(1), u.extent(2)};
+    if (terms.empty()) {
+        throw std::invalid_argument("hd::block_autotuner::tune(): no terms.");
+    }
+    std::string k = key(n, terms);
+    if (auto it = cache.find(k); it != cache.end()) return it->second;
+
+    // candidate tile sizes limited to the extents
+    auto candidates = [&](std::size_t ext) {
+        std::vector<std::size_t> c;
+        for (std::size_t t : par.tiles)
+            if (t > 0) c.push_back(std::min(t, ext));
+        std::sort(c.begin(), c.end());
+        c.erase(std::unique(c.begin(), c.end()), c.end());
+        return c;
+    };
+    auto c0 = candidates(n[0]), c1 = candidates(n[1]);
+    std::size_t nsteps = *std::max_element(par.steps.begin(), par.steps.end());
+
+    std::vector<double> mem_u(u.data_handle(), u.data_handle() + u.size()), mem_w(u.size());
+    field3d_t fu{mem_u.data(), n[0], n[1], n[2]}, fw{mem_w.data(), n[0], n[1], n[2]};
+
+    time_block_t best;
+    int t_best = std::numeric_limits<int>::max();
+    stop_watch sw;
+    for (std::size_t s : par.steps) {
+        for (std::size_t t0 : c0) {
+            for (std::size_t t1 : c1) {
+                for (unsigned th : par.threads) {
+                    time_block_t blk{std::max<std::size_t>(s, 1), t0, t1, th};
+                    int t_min = std::numeric_limits<int>::max();
+                    for (int rep = 0; rep < par.repeats; ++rep) {
+                        sw.reset();
+                        sw.start();
+                        advance_blocked(fu, fw, terms, dt, nsteps, blk);
+                        sw.stop();
+                        t_min = std::min(t_min, sw.elapsed_time(time_in::microseconds));
+                    }
+                    ++nbench;
+                    if (t_min < t_best) {
+                        t_best = t_min;
+                        best = blk;
+                    }
+                }
+            }
+        }
+    }
+
+    cache[k] = best;
+    save();
+    return best;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_AUTOTUNE_H
@@ -0,0 +1,240 @@
+#ifndef HD_STENCIL_COMPACT_H
+#define HD_STENCIL_COMPACT_H
+
+// compact (pade type) finite difference derivatives on uniform grids
+//
+//   sum_{|j| <= kl} a_j f'_{i+j} = sum_{|j| <= kr} b_j f_{i+j}     (or f'' on the lhs)
+//
+// The weights of all rows are computed with hd::stencil_t (the interior row once). Rows
+// closer to the boundary than the stencil half widths are closed by explicit one-sided
+// stencils with one rhs point more than the interior (truncated compact closures lead
+// to nearly singular lhs systems for f''). The banded lhs is factored once in the ctor.
+// Derivatives are applied along an axis of a 1D/2D/3D field by solving batches of lines
+// at once.
+//
+// Usage:
+//
+// hd::compact_derivative d1(n, h);                             // tridiagonal lhs, 5 point rhs
+// hd::compact_derivative d2(n, h, 1, 2, hd::stencil_lhs::f2);  // same for f''
+//
+// d1.apply(f, df, axis);  // f, df: mdspan<double (const), dextents<std::size_t, R>>, R = 1..3
+//                         // (line length n along axis)
+
+#include "hd/hd_solver.hpp"  // hd::band_lu_decomp(), hd::band_lu_backsubs_batch()
+#include "hd/hd_stencil.hpp" // hd::stencil_t
+
+#include <algorithm> // std::min(), std::max(), std::clamp()
+#include <cstddef>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+class compact_derivative {
+  public:
+    // n: number of points per line, h: grid spacing
+    // lhs_hw, rhs_hw: half width of lhs (1 == tridiagonal) and of rhs stencil
+    compact_derivative(std::size_t n, double h, int lhs_hw = 1, int rhs_hw = 2,
+                       stencil_lhs lhs_t = stencil_lhs::f1);
+
+    // derivative along axis of field f (lines of length n)
+    template <class E>
+    void apply(mdspan<double const, E> f, mdspan<double, E> df, std::size_t axis) const;
+    template <class E>
+    void apply(mdspan<double, E> f, mdspan<double, E> df, std::size_t axis) const
+    {
+        apply(mdspan<double const, E>(f), df, axis);
+    }
+
+    // derivative of nb lines stored interleaved: f[i * nb + m] is point i of line m
+    void apply_batch(double const* f, double* df, std::size_t nb) const;
+
+    std::size_t size() const { return n; }
+
+    static constexpr std::size_t batch_size = 16; // lines solved at once by apply()
+
+  private:
+    std::size_t n;
+    int kl;                        // half width of lhs band
+    int nw;                        // max. number of rhs points per row
+    std::vector<double> mem_lhs;   // LU factors of lhs, n x (2*kl + 1)
+    std::vector<std::size_t> rfst; // first rhs point of each row
+    std::vector<int> rcnt;         // number of rhs points of each row
+    std::vector<double> rw;        // rhs weights, n x nw
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline compact_derivative::compact_derivative(std::size_t n, double h, int lhs_hw, int rhs_hw,
+                                              stencil_lhs lhs_t) :
+    n{n}, kl{lhs_hw}, nw{2 * rhs_hw + 2}
+{
+    if (lhs_hw < 0 || rhs_hw < 1 || n < static_cast<std::size_t>(std::max(nw, 2 * kl + 1)) ||
+        h <= 0.0) {
+        throw std::invalid_argument("Inconsistent specification in ctor of hd::compact_derivative.");
+    }
+
+    mem_lhs.assign(n * (2 * kl + 1), 0.0);
+    rfst.resize(n);
+    rcnt.resize(n);
+    rw.assign(n * nw, 0.0);
+    mdspan lhs{mem_lhs.data(), n, static_cast<std::size_t>(2 * kl + 1)};
+
+    // weights of a row with lhs points [l0, l1] and rhs points [r0, r0 + nr) around point i
+    auto row_stencil = [&](int i, int l0, int l1, int r0, int nr) {
+        std::vector<double> xl, xr;
+        for (int j = l0; j <= l1; ++j)
+            xl.push_back((j - i) * h);
+        for (int j = r0; j < r0 + nr; ++j)
+            xr.push_back((j - i) * h);
+        if (lhs_t == stencil_lhs::f1) return stencil_t(0.0, lhs_t, xr, xl, {});
+        return stencil_t(0.0, lhs_t, xr, {}, xl);
+    };
+
+    int ni = n;
+    int bw = std::max(kl, rhs_hw); // rows closer to the boundary need closures
+    std::vector<double> wl_int, wr_int;
+
+    for (int i = 0; i < ni; ++i) {
+        bool interior = i >= bw && i < ni - bw;
+        int l0 = interior ? i - kl : i, l1 = interior ? i + kl : i;
+        int nr = interior ? nw - 1 : nw;
+        int r0 = interior ? i - rhs_hw : std::clamp(i - nr / 2, 0, ni - nr);
+        rfst[i] = r0;
+        rcnt[i] = nr;
+
+        std::vector<double> wl, wr;
+        if (interior) {
+            // interior rows share the weights of the first interior row
+            if (wl_int.empty()) {
+                stencil_t s = row_stencil(i, l0, l1, r0, nr);
+                wl_int = (lhs_t == stencil_lhs::f1) ? s.wf1 : s.wf2;
+                wr_int = s.wf0;
+            }
+            wl = wl_int;
+            wr = wr_int;
+        }
+        else {
+            stencil_t s = row_stencil(i, l0, l1, r0, nr);
+            wl = (lhs_t == stencil_lhs::f1) ? s.wf1 : s.wf2;
+            wr = s.wf0;
+        }
+        for (int j = l0; j <= l1; ++j)
+            lhs[i, j - i + kl] = wl[j - l0];
+        for (int t = 0; t < nr; ++t)
+            rw[i * nw + t] = wr[t];
+    }
+
+    band_lu_decomp(lhs, kl, kl);
+}
+
+inline void compact_derivative::apply_batch(double const* f, double* df, std::size_t nb) const
+{
+    // rhs
+    for (std::size_t i = 0; i < n; ++i) {
+        double* d = df + i * nb;
+        double const* w = rw.data() + i * nw;
+        double const* fi = f + rfst[i] * nb;
+        for (std::size_t m = 0; m < nb; ++m)
+            d[m] = w[0] * fi[m];
+        for (int t = 1; t < rcnt[i]; ++t) {
+            double const* ft = fi + t * nb;
+            for (std::size_t m = 0; m < nb; ++m)
+                d[m] += w[t] * ft[m];
+        }
+    }
+    // lhs
+    mdspan<double const, dextents<std::size_t, 2>> lhs{mem_lhs.data(), n,
+                                                       static_cast<std::size_t>(2 * kl + 1)};
+    band_lu_backsubs_batch(lhs, kl, kl, mdspan<double, dextents<std::size_t, 2>>{df, n, nb});
+}
+
+namespace detail {
+
+//******************************************************************************
+// lines along axis of field f are processed in batches of up to bs lines:
+// op(base, nb, stride) with base[m]: offset of the first point of line m < nb,
+// stride: offset between consecutive points of a line
+//******************************************************************************
+template <class M, class Op>
+void for_line_batches(M const& f, std::size_t axis, std::size_t bs, Op&& op)
+{
+    std::size_t outer = 1, inner = 1, n = f.extent(axis);
+    for (std::size_t a = 0; a < M::rank(); ++a) {
+        if (a < axis) outer *= f.extent(a);
+        if (a > axis) inner *= f.extent(a);
+    }
+    std::size_t nlines = outer * inner;
+    std::vector<std::size_t> base(bs);
+
+    for (std::size_t l0 = 0; l0 < nlines; l0 += bs) {
+        std::size_t nb = std::min(bs, nlines - l0);
+        for (std::size_t m = 0; m < nb; ++m) {
+            std::size_t l = l0 + m;
+            base[m] = (l / inner) * n * inner + l % inner;
+        }
+        op(base.data(), nb, inner);
+    }
+}
+
+// copy nb lines of n points into an interleaved workspace: ws[i * nb + m] (and back)
+inline void gather_lines(double const* f, std::size_t const* base, std::size_t nb, std::size_t n,
+                         std::size_t stride, double* ws)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t m = 0; m < nb; ++m)
+            ws[i * nb + m] = f[base[m] + i * stride];
+}
+
+inline void scatter_lines(double const* ws, std::size_t const* base, std::size_t nb,
+                          std::size_t n, std::size_t stride, double* f)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t m = 0; m < nb; ++m)
+            f[base[m] + i * stride] = ws[i * nb + m];
+}
+
+// check of extents of input and output for line operations along axis
+template <class E>
+void check_lines(mdspan<double const, E> f, mdspan<double, E> out, std::size_t axis,
+                 std::size_t n, char const* msg)
+{
+    if (axis >= E::rank() || f.extent(axis) != n) {
+        throw std::invalid_argument(msg);
+    }
+    for (std::size_t a = 0; a < E::rank(); ++a) {
+        if (f.extent(a) != out.extent(a)) {
+            throw std::invalid_argument(msg);
+        }
+    }
+}
+
+} // namespace detail
+
+//******************************************************************************
+// lines along axis are gathered in batches of batch_size into an interleaved workspace
+// (point i of all lines of a batch contiguous), solved together and scattered back
+//******************************************************************************
+template <class E>
+void compact_derivative::apply(mdspan<double const, E> f, mdspan<double, E> df,
+                               std::size_t axis) const
+{
+    detail::check_lines(f, df, axis, n,
+                        "hd::compact_derivative::apply(): invalid axis, line length or extents.");
+
+    std::vector<double> ws_f(n * batch_size), ws_df(n * batch_size);
+    detail::for_line_batches(f, axis, batch_size,
+                             [&](std::size_t const* base, std::size_t nb, std::size_t stride) {
+                                 detail::gather_lines(f.data_handle(), base, nb, n, stride,
+                                                      ws_f.data());
+                                 apply_batch(ws_f.data(), ws_df.data(), nb);
+                                 detail::scatter_lines(ws_df.data(), base, nb, n, stride,
+                                                       df.data_handle());
+                             });
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_COMPACT_H
@@ -0,0 +1,222 @@
+#ifndef HD_STENCIL_CONVERGENCE_H
+#define HD_STENCIL_CONVERGENCE_H
+
+// convergence study of an explicit stencil on a sequence of refined uniform grids
+//
+// The stencil is given by a stencil_t with coordinates in units of the grid spacing
+// (e.g. {-1, 0, 1}). Level l uses n_l = (n0 - 1) 2^l + 1 points on [a, b], i.e. the
+// spacing is halved from level to level. Each level applies the stencil to f at all
+// points with full stencil support, measures the error norms against the exact derivative
+// and the runtime of the application (min. of repeats). The levels run concurrently on a
+// hd::thread_pool (levels competing for memory bandwidth may increase the runtimes).
+//
+// Reported are the observed orders between successive levels, the order fitted to all
+// levels (least squares in log-log scale) and the expected order stencil_t::order().
+// cost(tol) estimates the runtime needed for a max. error tol from fits of the errors and
+// runtimes of the levels, i.e. the cheapest of several stencils for a given tolerance is
+// the one with the smallest cost(tol).
+//
+// Usage:
+//
+// hd::stencil_t s(0.0, hd::stencil_lhs::f1, {-2.0, -1.0, 0.0, 1.0, 2.0}, {0.0}, {});
+// auto rep = hd::convergence_study(s, [](double x) { return std::sin(x); },
+//                                  [](double x) { return std::cos(x); });
+// fmt::print("{}", rep.summary());
+
+#include "hd/hd_stencil.hpp"       // hd::stencil_t
+#include "hd/hd_stencil_apply.hpp" // hd::stencil_weights
+#include "hd/hd_thread_pool.hpp"   // hd::thread_pool
+
+#include <algorithm> // std::min(), std::max(), std::minmax_element()
+#include <chrono>
+#include <cmath> // std::abs(), std::sqrt(), std::log(), std::exp(), std::pow()
+#include <cstddef>
+#include <cstdio> // std::snprintf()
+#include <functional>
+#include <future>
+#include <limits>
+#include <stdexcept> // std::invalid_argument
+#include <string>
+#include <vector>
+
+namespace hd {
+
+struct convergence_param {
+    double a{0.0};       // interval [a, b]
+    double b{1.0};
+    std::size_t n0{17};  // points of the coarsest level
+    int levels{5};       // number of levels
+    int repeats{5};      // timings per level (min. is used)
+    unsigned threads{0}; // threads of the pool (0: hd::default_threads())
+};
+
+struct convergence_level {
+    std::size_t n;  // number of points
+    double h;       // grid spacing
+    double err_max; // max. norm of the error
+    double err_l2;  // discrete l2 norm of the error (sqrt(h sum e^2))
+    double seconds; // runtime of one application of the stencil
+};
+
+struct convergence_report {
+    std::vector<convergence_level> levels;
+    std::vector<double> order_observed; // between level l and l+1 (max. norm)
+    double order_fit{0.0};              // fitted to all levels with nonzero error
+    int order_expected{0};              // stencil_t::order()
+
+    // estimated runtime for a max. error tol (infinite if the error does not decrease)
+    double cost(double tol) const;
+    std::string summary() const;
+};
+
+convergence_report convergence_study(stencil_t const& s, std::function<double(double)> f,
+                                     std::function<double(double)> df_exact,
+                                     convergence_param const& par = {});
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// least squares fit y = c0 + c1 x, returns {c0, c1}
+inline std::pair<double, double> fit_line(std::vector<double> const& x,
+                                          std::vector<double> const& y)
+{
+    double n = x.size(), sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        sx += x[i];
+        sy += y[i];
+        sxx += x[i] * x[i];
+        sxy += x[i] * y[i];
+    }
+    double d = n * sxx - sx * sx;
+    if (x.size() < 2 || d == 0.0) return {n > 0 ? sy / n : 0.0, 0.0};
+    double c1 = (n * sxy - sx * sy) / d;
+    return {(sy - c1 * sx) / n, c1};
+}
+
+} // namespace detail
+
+//******************************************************************************
+// error ~ C h^p and runtime ~ D h^-q fitted in log-log scale: h(tol) = (tol/C)^(1/p)
+//******************************************************************************
+inline double convergence_report::cost(double tol) const
+{
+    std::vector<double> lh, le, lt;
+    for (auto const& l : levels) {
+        if (l.err_max > 0.0 && l.seconds > 0.0) {
+            lh.push_back(std::log(l.h));
+            le.push_back(std::log(l.err_max));
+            lt.push_back(std::log(l.seconds));
+        }
+    }
+    if (lh.size() < 2 || tol <= 0.0) return std::numeric_limits<double>::infinity();
+    auto [lc, p] = detail::fit_line(lh, le);
+    auto [ld, mq] = detail::fit_line(lh, lt);
+    if (p <= 0.0) return std::numeric_limits<double>::infinity();
+    double log_h = (std::log(tol) - lc) / p;
+    return std::exp(ld + mq * log_h);
+}
+
+inline std::string convergence_report::summary() const
+{
+    std::string s;
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "%8s %12s %12s %12s %12s %8s\n", "n", "h", "err_max",
+                  "err_l2", "seconds", "order");
+    s += buf;
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+        auto const& v = levels[l];
+        std::snprintf(buf, sizeof(buf), "%8zu %12.4e %12.4e %12.4e %12.4e", v.n, v.h, v.err_max,
+                      v.err_l2, v.seconds);
+        s += buf;
+        if (l > 0) {
+            std::snprintf(buf, sizeof(buf), " %8.3f", order_observed[l - 1]);
+            s += buf;
+        }
+        s += '\n';
+    }
+    std::snprintf(buf, sizeof(buf), "order: fitted %.3f, expected %d\n", order_fit, order_expected);
+    s += buf;
+    return s;
+}
+
+inline convergence_report convergence_study(stencil_t const& s, std::function<double(double)> f,
+                                            std::function<double(double)> df_exact,
+                                            convergence_param const& par)
+{
+    if (par.levels < 1 || par.n0 < 2 || par.repeats < 1 || !(par.b > par.a)) {
+        throw std::invalid_argument("hd::convergence_study(): inconsistent parameters.");
+    }
+    stencil_weights w(s, 1.0); // checks for explicit stencil with integer coordinates
+    int d = (s.lhs_t == stencil_lhs::f1) ? 1 : 2;
+    auto [omin, omax] = std::minmax_element(w.offset.begin(), w.offset.end());
+    std::size_t lo = std::max(0, -*omin), ro = std::max(0, *omax);
+
+    auto run_level = [&, lo, ro](int l) {
+        std::size_t n = (par.n0 - 1) * (std::size_t(1) << l) + 1;
+        double h = (par.b - par.a) / (n - 1);
+        if (n < lo + ro + 1) {
+            throw std::invalid_argument("hd::convergence_study(): grid smaller than stencil.");
+        }
+        std::vector<double> fv(n), df(n, 0.0), wh(w.weight);
+        for (std::size_t i = 0; i < n; ++i)
+            fv[i] = f(par.a + i * h);
+        for (double& x : wh)
+            x /= std::pow(h, d);
+
+        double t_min = std::numeric_limits<double>::infinity();
+        for (int r = 0; r < par.repeats; ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (std::size_t i = lo; i + ro < n; ++i) {
+                double sum = 0.0;
+                for (std::size_t j = 0; j < wh.size(); ++j)
+                    sum += wh[j] * fv[i + w.offset[j]];
+                df[i] = sum;
+            }
+            std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+            t_min = std::min(t_min, dt.count());
+        }
+
+        double emax = 0.0, e2 = 0.0;
+        for (std::size_t i = lo; i + ro < n; ++i) {
+            double e = std::abs(df[i] - df_exact(par.a + i * h));
+            emax = std::max(emax, e);
+            e2 += e * e;
+        }
+        return convergence_level{n, h, emax, std::sqrt(h * e2), t_min};
+    };
+
+    convergence_report rep;
+    {
+        thread_pool pool(par.threads > 0 ? par.threads : default_threads());
+        std::vector<std::future<convergence_level>> res;
+        for (int l = 0; l < par.levels; ++l)
+            res.push_back(pool.submit([&run_level, l] { return run_level(l); }));
+        for (auto& r : res)
+            rep.levels.push_back(r.get());
+    }
+
+    std::vector<double> lh, le;
+    for (std::size_t l = 0; l < rep.levels.size(); ++l) {
+        auto const& v = rep.levels[l];
+        if (l > 0) {
+            auto const& u = rep.levels[l - 1];
+            rep.order_observed.push_back((v.err_max > 0.0 && u.err_max > 0.0)
+                                             ? std::log(u.err_max / v.err_max) / std::log(u.h / v.h)
+                                             : 0.0);
+        }
+        if (v.err_max > 0.0) {
+            lh.push_back(std::log(v.h));
+            le.push_back(std::log(v.err_max));
+        }
+    }
+    rep.order_fit = detail::fit_line(lh, le).second;
+    rep.order_expected = s.order();
+    return rep;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_CONVERGENCE_H
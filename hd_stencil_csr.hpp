@@ -0,0 +1,153 @@
+#ifndef HD_STENCIL_CSR_H
+#define HD_STENCIL_CSR_H
+
+// assembly of stencil operators on uniform 3D grids into sparse matrices (e.g. for
+// implicit time integration with an iterative or sparse direct solver)
+//
+// The operator is a sum of stencils along the axes. Along each axis the first and last
+// points use boundary closures (e.g. one-sided stencils), all others the interior stencil.
+// Rows and columns are numbered in the memory order of the row major field, i.e.
+// y = A f is the same as applying the operator to the field. Entries of a row are sorted
+// by column, entries of different terms at the same point are combined.
+//
+// The matrix is assembled in two parallel passes: the exact size of all rows is computed
+// first, the entries are then written in place (no insertion into a growing structure).
+//
+// Usage:
+//
+// hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2, {-h, 0.0, h}, {}, {0.0}), h};
+// hd::stencil_weights d2l{hd::stencil_t(0.0, hd::stencil_lhs::f2, {0.0, h, 2*h, 3*h}, {}, {0.0}), h};
+// hd::stencil_weights d2r{hd::stencil_t(0.0, hd::stencil_lhs::f2, {-3*h, -2*h, -h, 0.0}, {}, {0.0}), h};
+//
+// std::vector<hd::axis_operator> lap{{0, d2, {d2l}, {d2r}}, {1, d2, {d2l}, {d2r}}};
+// hd::csr_matrix a = hd::assemble_csr({1, ny, nx}, lap);    // 2D as 3D with unit extent
+
+#include "hd/hd_csr.hpp"           // hd::csr_matrix
+#include "hd/hd_parallel.hpp"      // hd::parallel_for()
+#include "hd/hd_stencil_apply.hpp" // hd::stencil_weights
+
+#include <algorithm> // std::sort()
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+// stencils of one term along an axis
+struct axis_operator {
+    std::size_t axis;
+    stencil_weights interior;
+    std::vector<stencil_weights> left;  // closure of point k (k = 0 ... left.size()-1)
+    std::vector<stencil_weights> right; // closure of point n-1-k (k = 0 ... right.size()-1)
+};
+
+// n: extents of the field (1D and 2D with unit extents in the leading axes)
+csr_matrix assemble_csr(std::array<std::size_t, 3> n, std::span<axis_operator const> terms,
+                        unsigned nthreads = 0);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline stencil_weights const& select_stencil(axis_operator const& t, std::size_t i,
+                                             std::size_t n)
+{
+    if (i < t.left.size()) return t.left[i];
+    if (n - 1 - i < t.right.size()) return t.right[n - 1 - i];
+    return t.interior;
+}
+
+// merged entries (column, value) of row idx sorted by column
+inline void csr_row(std::array<std::size_t, 3> n, std::span<axis_operator const> terms,
+                    std::array<std::size_t, 3> idx, std::vector<std::pair<std::size_t, double>>& e)
+{
+    std::size_t stride[3] = {n[1] * n[2], n[2], 1};
+    std::size_t row = idx[0] * stride[0] + idx[1] * stride[1] + idx[2];
+
+    e.clear();
+    for (auto const& t : terms) {
+        std::size_t a = t.axis;
+        stencil_weights const& w = select_stencil(t, idx[a], n[a]);
+        for (int j = 0; j < w.size(); ++j) {
+            std::ptrdiff_t p = std::ptrdiff_t(idx[a]) + w.offset[j];
+            if (p < 0 || p >= std::ptrdiff_t(n[a])) {
+                throw std::invalid_argument("hd::assemble_csr(): stencil exceeds the grid (closure missing?).");
+            }
+            e.emplace_back(row + (p - std::ptrdiff_t(idx[a])) * std::ptrdiff_t(stride[a]), w.weight[j]);
+        }
+    }
+    std::sort(e.begin(), e.end(), [](auto const& x, auto const& y) { return x.first < y.first; });
+    std::size_t m = 0;
+    for (std::size_t j = 1; j < e.size(); ++j) {
+        if (e[j].first == e[m].first)
+            e[m].second += e[j].second;
+        else
+            e[++m] = e[j];
+    }
+    if (!e.empty()) e.resize(m + 1);
+}
+
+} // namespace detail
+
+inline csr_matrix assemble_csr(std::array<std::size_t, 3> n, std::span<axis_operator const> terms,
+                               unsigned nthreads)
+{
+    if (terms.empty() || n[0] * n[1] * n[2] == 0) {
+        throw std::invalid_argument("hd::assemble_csr(): no terms or empty grid.");
+    }
+    for (auto const& t : terms) {
+        if (t.axis > 2 || t.interior.size() == 0) {
+            throw std::invalid_argument("hd::assemble_csr(): invalid axis or empty interior stencil.");
+        }
+    }
+    std::size_t nr = n[0] * n[1] * n[2];
+    auto index = [&](std::size_t r) {
+        return std::array<std::size_t, 3>{r / (n[1] * n[2]), (r / n[2]) % n[1], r % n[2]};
+    };
+
+    csr_matrix a;
+    a.nrows = a.ncols = nr;
+    a.row_ptr.assign(nr + 1, 0);
+
+    // 1.) exact row sizes
+    parallel_for(
+        nr,
+        [&](std::size_t r0, std::size_t r1, unsigned) {
+            std::vector<std::pair<std::size_t, double>> e;
+            for (std::size_t r = r0; r < r1; ++r) {
+                detail::csr_row(n, terms, index(r), e);
+                a.row_ptr[r + 1] = e.size();
+            }
+        },
+        nthreads);
+    for (std::size_t r = 0; r < nr; ++r)
+        a.row_ptr[r + 1] += a.row_ptr[r];
+
+    // 2.) entries written in place
+    a.col.resize(a.row_ptr[nr]);
+    a.val.resize(a.row_ptr[nr]);
+    parallel_for(
+        nr,
+        [&](std::size_t r0, std::size_t r1, unsigned) {
+            std::vector<std::pair<std::size_t, double>> e;
+            for (std::size_t r = r0; r < r1; ++r) {
+                detail::csr_row(n, terms, index(r), e);
+                std::size_t p = a.row_ptr[r];
+                for (auto const& [c, v] : e) {
+                    a.col[p] = c;
+                    a.val[p++] = v;
+                }
+            }
+        },
+        nthreads);
+    return a;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_CSR_H
@@ -0,0 +1,246 @@
+#ifndef HD_STENCIL_FIELD_H
+#define HD_STENCIL_FIELD_H
+
+// 3D field with ghost layers for branch-free application of stencils
+//
+// The field owns its memory: n[a] interior points plus g[a] ghost layers on both sides of
+// each axis. Rows (axis 2) are padded such that the first interior point of every row is
+// aligned to 64 bytes, i.e. the interior kernels run over complete rows without any test
+// for boundary points and vectorize with aligned loads.
+//
+// The ghost layers are filled from the interior before each application of stencils:
+//
+//   periodic:    f[-g] = f[n-g]                      f[n-1+g] = f[g-1]
+//   even:        f[-g] = f[g]                        (mirror symmetric, e.g. zero flux)
+//   odd:         f[-g] = 2 f[0] - f[g]               (antisymmetric w.r.t. boundary value)
+//                (even and odd require g < n)
+//   extrapolate: polynomial through the first np interior points (one-sided closure of
+//                order np, np = extrap_points)
+//
+// Usage:
+//
+// std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+// hd::padded_field u({n0, n1, n2}, hd::terms_radius(lap)), lu({n0, n1, n2}, {0, 0, 0});
+//
+// u[i, j, k] = ...;                                   // interior (ghosts: negative indices)
+// u.fill_ghosts({hd::ghost_fill::periodic, ...}, {hd::ghost_fill::periodic, ...});
+// hd::apply_padded(u, lu, lap);                       // lu = L(u) at all interior points
+
+#include "hd/hd_stencil_apply.hpp" // hd::axis_stencil, hd::merge_terms()
+
+#include <array>
+#include <cstddef>
+#include <memory>    // std::unique_ptr
+#include <new>       // std::align_val_t
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+enum class ghost_fill { periodic, even, odd, extrapolate };
+
+class padded_field {
+  public:
+    static constexpr std::size_t alignment = 64; // bytes
+
+    // n: interior extents, g: ghost layers per axis (e.g. hd::terms_radius(terms))
+    padded_field(std::array<std::size_t, 3> n, std::array<std::size_t, 3> g,
+                 int extrap_points = 3);
+
+    // i, j, k: interior indices, ghost points at -g ... -1 and n ... n+g-1
+    double& operator[](std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k)
+    {
+        return mem[offset(i, j, k)];
+    }
+    double operator[](std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) const
+    {
+        return mem[offset(i, j, k)];
+    }
+
+    // view of the interior points
+    mdspan<double, dextents<std::size_t, 3>, Kokkos::layout_stride> interior();
+
+    void fill_ghosts(std::size_t axis, ghost_fill lo, ghost_fill hi);
+    // all axes in order 0, 1, 2 (fills the edges and corners as well)
+    void fill_ghosts(std::array<ghost_fill, 3> lo, std::array<ghost_fill, 3> hi);
+
+    std::array<std::size_t, 3> extents() const { return n; }
+    std::array<std::size_t, 3> ghost() const { return g; }
+    std::array<std::ptrdiff_t, 3> strides() const { return {s0, s1, 1}; }
+
+    // position of interior point (i, j, k) in memory
+    std::ptrdiff_t offset(std::ptrdiff_t i, std::ptrdiff_t j, std::ptrdiff_t k) const
+    {
+        return origin + i * s0 + j * s1 + k;
+    }
+    double* data() { return mem.get(); }
+    double const* data() const { return mem.get(); }
+
+  private:
+    struct aligned_delete {
+        void operator()(double* p) const { ::operator delete[](p, std::align_val_t{alignment}); }
+    };
+
+    std::array<std::size_t, 3> n, g;
+    int extrap_points;
+    std::ptrdiff_t s0, s1, origin;
+    std::unique_ptr<double[], aligned_delete> mem;
+};
+
+// out = sum of terms applied to f at all interior points (ghosts of out are not written)
+void apply_padded(padded_field const& f, padded_field& out, std::span<axis_stencil const> terms);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline padded_field::padded_field(std::array<std::size_t, 3> n, std::array<std::size_t, 3> g,
+                                  int extrap_points) :
+    n{n}, g{g}, extrap_points{extrap_points}
+{
+    for (int a = 0; a < 3; ++a) {
+        if (n[a] == 0 || g[a] > n[a]) {
+            throw std::invalid_argument("Inconsistent extents or ghost layers in ctor of hd::padded_field.");
+        }
+    }
+    if (extrap_points < 1) {
+        throw std::invalid_argument("hd::padded_field: extrap_points < 1.");
+    }
+    // row: front padding, ghosts, interior (aligned), ghosts, back padding
+    constexpr std::size_t va = alignment / sizeof(double);
+    std::size_t front = (va - g[2] % va) % va;
+    std::size_t ld = (front + n[2] + 2 * g[2] + va - 1) / va * va;
+    s1 = ld;
+    s0 = (n[1] + 2 * g[1]) * ld;
+    origin = g[0] * s0 + g[1] * s1 + front + g[2];
+
+    std::size_t size = (n[0] + 2 * g[0]) * s0;
+    mem.reset(new (std::align_val_t{alignment}) double[size]());
+}
+
+inline mdspan<double, dextents<std::size_t, 3>, Kokkos::layout_stride> padded_field::interior()
+{
+    using ext_t = dextents<std::size_t, 3>;
+    Kokkos::layout_stride::mapping<ext_t> map{
+        ext_t{n[0], n[1], n[2]}, std::array<std::size_t, 3>{std::size_t(s0), std::size_t(s1), 1}};
+    return {mem.get() + origin, map};
+}
+
+//******************************************************************************
+// ghost layers of one axis over the full (padded) range of the other axes
+//******************************************************************************
+inline void padded_field::fill_ghosts(std::size_t axis, ghost_fill lo, ghost_fill hi)
+{
+    if (axis > 2) {
+        throw std::invalid_argument("hd::padded_field::fill_ghosts(): invalid axis.");
+    }
+    std::ptrdiff_t na = n[axis], ga = g[axis];
+    if (ga == 0) return;
+    std::ptrdiff_t sa = strides()[axis];
+    if ((lo == ghost_fill::extrapolate || hi == ghost_fill::extrapolate) && extrap_points > na) {
+        throw std::invalid_argument("hd::padded_field::fill_ghosts(): extrap_points > extent.");
+    }
+    // mirrored points l = 1 ... ga must be interior points
+    auto mirror = [](ghost_fill bc) { return bc == ghost_fill::even || bc == ghost_fill::odd; };
+    if ((mirror(lo) || mirror(hi)) && ga >= na) {
+        throw std::invalid_argument("hd::padded_field::fill_ghosts(): even/odd fill requires ghost layers < extent.");
+    }
+
+    // lagrange weights for the values at -1 ... -ga from the points 0 ... np-1
+    int np = extrap_points;
+    std::vector<double> ce(ga * np);
+    for (std::ptrdiff_t l = 1; l <= ga; ++l)
+        for (int p = 0; p < np; ++p) {
+            double c = 1.0;
+            for (int q = 0; q < np; ++q)
+                if (q != p) c *= double(-l - q) / (p - q);
+            ce[(l - 1) * np + p] = c;
+        }
+
+    // fill one line: b points to interior point 0, dir = +1 (low side) or -1 (high side)
+    auto fill = [&](double* b, std::ptrdiff_t dir, ghost_fill bc) {
+        std::ptrdiff_t st = dir * sa; // stride towards the interior
+        for (std::ptrdiff_t l = 1; l <= ga; ++l) {
+            double& v = b[-l * st];
+            switch (bc) {
+                case ghost_fill::periodic:
+                    v = b[(na - l) * st];
+                    break;
+                case ghost_fill::even:
+                    v = b[l * st];
+                    break;
+                case ghost_fill::odd:
+                    v = 2.0 * b[0] - b[l * st];
+                    break;
+                case ghost_fill::extrapolate:
+                    v = 0.0;
+                    for (int p = 0; p < np; ++p)
+                        v += ce[(l - 1) * np + p] * b[p * st];
+                    break;
+            }
+        }
+    };
+
+    // all lines along axis (incl. ghost points of the other axes)
+    std::size_t o1 = axis == 0 ? 1 : 0, o2 = axis == 2 ? 1 : 2;
+    std::ptrdiff_t g1 = g[o1], g2 = g[o2], n1 = n[o1], n2 = n[o2];
+    std::ptrdiff_t t1 = strides()[o1], t2 = strides()[o2];
+    for (std::ptrdiff_t i = -g1; i < n1 + g1; ++i)
+        for (std::ptrdiff_t j = -g2; j < n2 + g2; ++j) {
+            double* b = mem.get() + origin + i * t1 + j * t2;
+            fill(b, 1, lo);
+            fill(b + (na - 1) * sa, -1, hi);
+        }
+}
+
+inline void padded_field::fill_ghosts(std::array<ghost_fill, 3> lo, std::array<ghost_fill, 3> hi)
+{
+    for (std::size_t a = 0; a < 3; ++a)
+        fill_ghosts(a, lo[a], hi[a]);
+}
+
+//******************************************************************************
+// row kernel without boundary tests: the neighbours of all interior points are either
+// interior or ghost points
+//******************************************************************************
+inline void apply_padded(padded_field const& f, padded_field& out, std::span<axis_stencil const> terms)
+{
+    auto n = f.extents();
+    auto r = terms_radius(terms);
+    if (out.extents() != n || terms.empty()) {
+        throw std::invalid_argument("hd::apply_padded(): extents of fields incompatible or no terms.");
+    }
+    for (int a = 0; a < 3; ++a) {
+        if (r[a] > f.ghost()[a]) {
+            throw std::invalid_argument("hd::apply_padded(): ghost layers smaller than stencil radius.");
+        }
+    }
+    auto s = f.strides();
+    std::vector<std::pair<std::ptrdiff_t, double>> taps;
+    for (auto const& tp : merge_terms(terms))
+        taps.emplace_back(tp.d[0] * s[0] + tp.d[1] * s[1] + tp.d[2], tp.w);
+
+    std::size_t nk = n[2];
+    for (std::size_t i = 0; i < n[0]; ++i) {
+        for (std::size_t j = 0; j < n[1]; ++j) {
+            double const* src = f.data() + f.offset(i, j, 0);
+            double* dst = out.data() + out.offset(i, j, 0);
+            double const* t0 = src + taps[0].first;
+            double w0 = taps[0].second;
+            for (std::size_t k = 0; k < nk; ++k)
+                dst[k] = w0 * t0[k];
+            for (std::size_t t = 1; t < taps.size(); ++t) {
+                double const* tt = src + taps[t].first;
+                double w = taps[t].second;
+                for (std::size_t k = 0; k < nk; ++k)
+                    dst[k] += w * tt[k];
+            }
+        }
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_FIELD_H
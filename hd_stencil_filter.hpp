@@ -0,0 +1,218 @@
+#ifndef HD_STENCIL_FILTER_H
+#define HD_STENCIL_FILTER_H
+
+// low-pass filters of order 2 ... 10 on uniform grids (gaitonde & visbal 2000)
+//
+//   alpha ff_{i-1} + ff_i + alpha ff_{i+1} = sum_{k=0}^{N} a_k/2 (f_{i+k} + f_{i-k})
+//
+// order 2N, -0.5 < alpha <= 0.5 controls the cutoff (alpha -> 0.5: less dissipation,
+// alpha == 0: explicit filter). All filters remove the odd-even mode (2 points per wave)
+// and preserve polynomials up to degree 2N-1.
+// Rows closer to the boundary than N use the centered filter of the highest order that
+// fits (reduced order closures), the boundary points are not filtered.
+// strength blends the result with the input: ff = f + strength * (F(f) - f).
+//
+// Usage:
+//
+// hd::compact_filter flt(n);                    // 10th order, alpha = 0.45
+// hd::compact_filter flt_ex(n, 8, 0.0, 0.2);    // explicit 8th order with 20% strength
+//
+// flt.apply(f, ff, axis);                       // cmp. hd::compact_derivative::apply()
+// hd::filter_and_derive(flt, d1, f, ff, df, axis);   // ff = F(f) and df = D(ff) in one sweep
+
+#include "hd/hd_solver.hpp"          // hd::band_lu_decomp(), hd::band_lu_backsubs_batch()
+#include "hd/hd_stencil_compact.hpp" // hd::compact_derivative, line batch helpers
+
+#include <algorithm> // std::min()
+#include <array>
+#include <cstddef>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+class compact_filter {
+  public:
+    // n: number of points per line, order: 2, 4, 6, 8 or 10
+    compact_filter(std::size_t n, int order = 10, double alpha = 0.45, double strength = 1.0);
+
+    template <class E>
+    void apply(mdspan<double const, E> f, mdspan<double, E> ff, std::size_t axis) const;
+    template <class E>
+    void apply(mdspan<double, E> f, mdspan<double, E> ff, std::size_t axis) const
+    {
+        apply(mdspan<double const, E>(f), ff, axis);
+    }
+
+    // filter nb lines stored interleaved: f[i * nb + m] is point i of line m
+    void apply_batch(double const* f, double* ff, std::size_t nb) const;
+
+    std::size_t size() const { return n; }
+
+    static constexpr std::size_t batch_size = compact_derivative::batch_size;
+
+  private:
+    std::size_t n;
+    int hw_max;                  // N = order / 2
+    double alpha, strength;
+    std::vector<double> mem_lhs; // LU factors of tridiagonal lhs, n x 3 (empty if explicit)
+    std::vector<int> hw;         // half width of rhs of each row (0: not filtered)
+    std::vector<double> rw;      // rhs coefficients of each row, n x (N + 1): a_0, a_1/2, ...
+};
+
+// coefficients a_0 ... a_N of the filter of order 2N
+std::vector<double> filter_coefficients(int order, double alpha);
+
+// ff = F(f) and df = D(F(f)) along axis in one sweep over the field
+template <class E>
+void filter_and_derive(compact_filter const& flt, compact_derivative const& d,
+                       mdspan<double const, E> f, mdspan<double, E> ff, mdspan<double, E> df,
+                       std::size_t axis);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline std::vector<double> filter_coefficients(int order, double a)
+{
+    switch (order) {
+        case 2:
+            return {0.5 + a, 0.5 + a};
+        case 4:
+            return {5.0 / 8.0 + 0.75 * a, 0.5 + a, -1.0 / 8.0 + 0.25 * a};
+        case 6:
+            return {11.0 / 16.0 + 5.0 / 8.0 * a, 15.0 / 32.0 + 17.0 / 16.0 * a,
+                    -3.0 / 16.0 + 3.0 / 8.0 * a, 1.0 / 32.0 - 1.0 / 16.0 * a};
+        case 8:
+            return {(93.0 + 70.0 * a) / 128.0, (7.0 + 18.0 * a) / 16.0, (-7.0 + 14.0 * a) / 32.0,
+                    (1.0 - 2.0 * a) / 16.0, (-1.0 + 2.0 * a) / 128.0};
+        case 10:
+            return {(193.0 + 126.0 * a) / 256.0, (105.0 + 302.0 * a) / 256.0,
+                    15.0 * (-1.0 + 2.0 * a) / 64.0, 45.0 * (1.0 - 2.0 * a) / 512.0,
+                    5.0 * (-1.0 + 2.0 * a) / 256.0, (1.0 - 2.0 * a) / 512.0};
+        default:
+            throw std::invalid_argument("hd::filter_coefficients(): order must be 2, 4, 6, 8 or 10.");
+    }
+}
+
+inline compact_filter::compact_filter(std::size_t n, int order, double alpha, double strength) :
+    n{n}, hw_max{order / 2}, alpha{alpha}, strength{strength}
+{
+    if (n < 1 || alpha <= -0.5 || alpha > 0.5 || strength < 0.0 || strength > 1.0) {
+        throw std::invalid_argument("Inconsistent specification in ctor of hd::compact_filter.");
+    }
+    filter_coefficients(order, alpha); // checks order
+
+    std::vector<std::vector<double>> coef(hw_max + 1);
+    for (int k = 1; k <= hw_max; ++k)
+        coef[k] = filter_coefficients(2 * k, alpha);
+
+    hw.resize(n);
+    rw.assign(n * (hw_max + 1), 0.0);
+    if (alpha != 0.0) mem_lhs.assign(n * 3, 0.0);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        int h = std::min<std::size_t>({std::size_t(hw_max), i, n - 1 - i});
+        hw[i] = h;
+        double* w = rw.data() + i * (hw_max + 1);
+        if (h == 0) {
+            w[0] = 1.0;
+        }
+        else {
+            w[0] = coef[h][0];
+            for (int k = 1; k <= h; ++k)
+                w[k] = 0.5 * coef[h][k];
+        }
+        if (alpha != 0.0) {
+            mem_lhs[i * 3 + 1] = 1.0;
+            if (h > 0) {
+                mem_lhs[i * 3] = alpha;
+                mem_lhs[i * 3 + 2] = alpha;
+            }
+        }
+    }
+
+    if (alpha != 0.0) {
+        band_lu_decomp(mdspan{mem_lhs.data(), n, std::size_t(3)}, 1, 1);
+    }
+}
+
+inline void compact_filter::apply_batch(double const* f, double* ff, std::size_t nb) const
+{
+    // rhs (symmetric)
+    for (std::size_t i = 0; i < n; ++i) {
+        double* d = ff + i * nb;
+        double const* w = rw.data() + i * (hw_max + 1);
+        double const* fi = f + i * nb;
+        for (std::size_t m = 0; m < nb; ++m)
+            d[m] = w[0] * fi[m];
+        for (int k = 1; k <= hw[i]; ++k) {
+            double const* fp = fi + k * nb;
+            double const* fm = fi - k * nb;
+            for (std::size_t m = 0; m < nb; ++m)
+                d[m] += w[k] * (fp[m] + fm[m]);
+        }
+    }
+    // lhs
+    if (alpha != 0.0) {
+        mdspan<double const, dextents<std::size_t, 2>> lhs{mem_lhs.data(), n, std::size_t(3)};
+        band_lu_backsubs_batch(lhs, 1, 1, mdspan<double, dextents<std::size_t, 2>>{ff, n, nb});
+    }
+    // blending with input
+    if (strength != 1.0) {
+        for (std::size_t i = 0; i < n * nb; ++i)
+            ff[i] = f[i] + strength * (ff[i] - f[i]);
+    }
+}
+
+template <class E>
+void compact_filter::apply(mdspan<double const, E> f, mdspan<double, E> ff,
+                           std::size_t axis) const
+{
+    detail::check_lines(f, ff, axis, n,
+                        "hd::compact_filter::apply(): invalid axis, line length or extents.");
+
+    std::vector<double> ws_f(n * batch_size), ws_ff(n * batch_size);
+    detail::for_line_batches(f, axis, batch_size,
+                             [&](std::size_t const* base, std::size_t nb, std::size_t stride) {
+                                 detail::gather_lines(f.data_handle(), base, nb, n, stride,
+                                                      ws_f.data());
+                                 apply_batch(ws_f.data(), ws_ff.data(), nb);
+                                 detail::scatter_lines(ws_ff.data(), base, nb, n, stride,
+                                                       ff.data_handle());
+                             });
+}
+
+//******************************************************************************
+// the lines are gathered once, filtered and differentiated in the workspace
+//******************************************************************************
+template <class E>
+void filter_and_derive(compact_filter const& flt, compact_derivative const& d,
+                       mdspan<double const, E> f, mdspan<double, E> ff, mdspan<double, E> df,
+                       std::size_t axis)
+{
+    std::size_t n = flt.size();
+    if (d.size() != n) {
+        throw std::invalid_argument("hd::filter_and_derive(): line length of filter and derivative differ.");
+    }
+    detail::check_lines(f, ff, axis, n, "hd::filter_and_derive(): invalid axis, line length or extents.");
+    detail::check_lines(f, df, axis, n, "hd::filter_and_derive(): invalid axis, line length or extents.");
+
+    std::size_t bs = compact_filter::batch_size;
+    std::vector<double> ws_f(n * bs), ws_ff(n * bs), ws_df(n * bs);
+    detail::for_line_batches(f, axis, bs,
+                             [&](std::size_t const* base, std::size_t nb, std::size_t stride) {
+                                 detail::gather_lines(f.data_handle(), base, nb, n, stride,
+                                                      ws_f.data());
+                                 flt.apply_batch(ws_f.data(), ws_ff.data(), nb);
+                                 d.apply_batch(ws_ff.data(), ws_df.data(), nb);
+                                 detail::scatter_lines(ws_ff.data(), base, nb, n, stride,
+                                                       ff.data_handle());
+                                 detail::scatter_lines(ws_df.data(), base, nb, n, stride,
+                                                       df.data_handle());
+                             });
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_FILTER_H
@@ -0,0 +1,313 @@
+#ifndef HD_STENCIL_LSRK_H
+#define HD_STENCIL_LSRK_H
+
+// method of lines time integration u' = L(t, u) with low storage runge-kutta schemes
+//
+// All schemes are formulated in terms of one fused operation provided by the rhs operator
+//
+//   op(t, src, aux, dst, alpha, beta, gdt):   dst = alpha*aux + beta*src + gdt*L(t, src)
+//
+// i.e. the stage update is combined with the evaluation of the rhs in a single pass over
+// the fields. aux may be the same field as dst (it is read pointwise only), src must not.
+//
+// Registers (fields of the size of u) needed per scheme:
+//
+//   lsrk_step():   2 (u, du)      williamson 2N form:  du = a_k*du + dt*L(u);  u += b_k*du
+//   ssprk2_step(): 2 (u, r1)      SSP(2,2)
+//   ssprk3_step(): 3 (u, r1, r2)  SSP(3,3) of shu-osher (no 2N form exists)
+//
+// The update u += b_k*du of a 2N stage needs a second pass over the fields for a general
+// operator. For hd::stencil_rhs it is fused into the evaluation of du (lsrk_step()
+// overload): the planes of u are updated lagging by the stencil radius in axis 0, i.e.
+// as soon as no stencil of the current stage reads them anymore.
+//
+// Usage:
+//
+// hd::stencil_rhs op(lap);                                    // L(u) = sum of stencils
+// auto tab = hd::lsrk_carpenter_kennedy4();
+// for (int s = 0; s < nsteps; ++s, t += dt)
+//     hd::lsrk_step(tab, op, t, dt, u, du);
+
+#include "hd/hd_stencil_apply.hpp" // hd::axis_stencil, hd::merge_terms()
+
+#include <algorithm> // std::fill()
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+// low storage runge-kutta scheme in williamson 2N form
+struct lsrk_tableau {
+    std::vector<double> a; // a[0] == 0
+    std::vector<double> b;
+    std::vector<double> c; // stage times as fraction of dt
+    int order;
+
+    int stages() const { return a.size(); }
+};
+
+lsrk_tableau lsrk_williamson3();        // 3 stages, 3rd order (williamson 1980)
+lsrk_tableau lsrk_carpenter_kennedy4(); // 5 stages, 4th order (carpenter & kennedy 1994)
+
+template <class E, class Op>
+void lsrk_step(lsrk_tableau const& tab, Op const& op, double t, double dt,
+               mdspan<double, E> u, mdspan<double, E> du);
+
+template <class E, class Op>
+void ssprk2_step(Op const& op, double t, double dt, mdspan<double, E> u,
+                 mdspan<double, E> r1);
+
+template <class E, class Op>
+void ssprk3_step(Op const& op, double t, double dt, mdspan<double, E> u,
+                 mdspan<double, E> r1, mdspan<double, E> r2);
+
+// rhs operator L(u) = sum of stencils along the axes of a 3D field
+// (points without full stencil support: L = 0, i.e. boundary values are kept)
+//
+// The tap offsets and the row buffer are kept between calls (rebuilt on a change of the
+// extents), i.e. an instance must not be used by several threads concurrently.
+class stencil_rhs {
+  public:
+    stencil_rhs(std::vector<axis_stencil> terms);
+
+    void operator()(double t, cfield3d_t src, cfield3d_t aux, field3d_t dst, double alpha,
+                    double beta, double gdt) const;
+
+    // stage of a 2N scheme in one pass: du = a*du + dt*L(u);  u += b*du
+    void stage_2n(double t, field3d_t u, field3d_t du, double a, double b, double dt) const;
+
+  private:
+    std::vector<stencil_tap> taps;
+    std::array<std::size_t, 3> r;
+
+    mutable std::array<std::size_t, 3> n{0, 0, 0};
+    mutable std::vector<std::pair<std::ptrdiff_t, double>> mt; // memory offsets of taps
+    mutable std::vector<double> acc;                           // L of one row
+
+    void prepare(std::array<std::size_t, 3> m) const;
+    void row(double const* ps, std::size_t i, std::size_t j) const; // acc = L(src) of row
+};
+
+// one time step of a williamson 2N scheme with the u update fused into the stages
+void lsrk_step(lsrk_tableau const& tab, stencil_rhs const& op, double t, double dt,
+               field3d_t u, field3d_t du);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline lsrk_tableau lsrk_williamson3()
+{
+    return {{0.0, -5.0 / 9.0, -153.0 / 128.0},
+            {1.0 / 3.0, 15.0 / 16.0, 8.0 / 15.0},
+            {0.0, 1.0 / 3.0, 3.0 / 4.0},
+            3};
+}
+
+inline lsrk_tableau lsrk_carpenter_kennedy4()
+{
+    return {{0.0, -567301805773.0 / 1357537059087.0, -2404267990393.0 / 2016746695238.0,
+             -3550918686646.0 / 2091501179385.0, -1275806237668.0 / 842570457699.0},
+            {1432997174477.0 / 9575080441755.0, 5161836677717.0 / 13612068292357.0,
+             1720146321549.0 / 2090206949498.0, 3134564353537.0 / 4481467310338.0,
+             2277821191437.0 / 14882151754819.0},
+            {0.0, 1432997174477.0 / 9575080441755.0, 2526269341429.0 / 6820363962896.0,
+             2006345519317.0 / 3224310063776.0, 2802321613138.0 / 2924317926251.0},
+            4};
+}
+
+namespace detail {
+
+template <class E>
+void check_registers(mdspan<double, E> u, mdspan<double, E> r)
+{
+    for (std::size_t a = 0; a < E::rank(); ++a) {
+        if (u.extent(a) != r.extent(a)) {
+            throw std::invalid_argument("hd: extents of time integration registers incompatible.");
+        }
+    }
+    if (u.data_handle() == r.data_handle()) {
+        throw std::invalid_argument("hd: time integration registers must be distinct.");
+    }
+}
+
+} // namespace detail
+
+//******************************************************************************
+// one time step of a williamson 2N scheme; du is scratch (content on entry is ignored)
+//******************************************************************************
+template <class E, class Op>
+void lsrk_step(lsrk_tableau const& tab, Op const& op, double t, double dt, mdspan<double, E> u,
+               mdspan<double, E> du)
+{
+    detail::check_registers(u, du);
+    mdspan<double const, E> cu(u), cdu(du);
+
+    for (int k = 0; k < tab.stages(); ++k) {
+        // du = a_k*du + dt*L(u) (a_0 == 0, i.e. du need not be initialized)
+        op(t + tab.c[k] * dt, cu, cdu, du, tab.a[k], 0.0, dt);
+        // u += b_k*du
+        double* pu = u.data_handle();
+        double const* pdu = du.data_handle();
+        double b = tab.b[k];
+        for (std::size_t i = 0; i < u.size(); ++i)
+            pu[i] += b * pdu[i];
+    }
+}
+
+//******************************************************************************
+// SSP(2,2):  r1 = u + dt*L(u);  u = 1/2*u + 1/2*r1 + 1/2*dt*L(r1)
+//******************************************************************************
+template <class E, class Op>
+void ssprk2_step(Op const& op, double t, double dt, mdspan<double, E> u, mdspan<double, E> r1)
+{
+    detail::check_registers(u, r1);
+    mdspan<double const, E> cu(u), cr1(r1);
+
+    op(t, cu, cu, r1, 0.0, 1.0, dt);
+    op(t + dt, cr1, cu, u, 0.5, 0.5, 0.5 * dt);
+}
+
+//******************************************************************************
+// SSP(3,3):  r1 = u + dt*L(u)
+//            r2 = 3/4*u + 1/4*r1 + 1/4*dt*L(r1)
+//            u  = 1/3*u + 2/3*r2 + 2/3*dt*L(r2)
+//******************************************************************************
+template <class E, class Op>
+void ssprk3_step(Op const& op, double t, double dt, mdspan<double, E> u, mdspan<double, E> r1,
+                 mdspan<double, E> r2)
+{
+    detail::check_registers(u, r1);
+    detail::check_registers(u, r2);
+    detail::check_registers(r1, r2);
+    mdspan<double const, E> cu(u), cr1(r1), cr2(r2);
+
+    op(t, cu, cu, r1, 0.0, 1.0, dt);
+    op(t + dt, cr1, cu, r2, 0.75, 0.25, 0.25 * dt);
+    op(t + 0.5 * dt, cr2, cu, u, 1.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0 * dt);
+}
+
+inline stencil_rhs::stencil_rhs(std::vector<axis_stencil> terms) :
+    taps{merge_terms(terms)}, r{terms_radius(terms)}
+{
+    if (terms.empty()) {
+        throw std::invalid_argument("hd::stencil_rhs: no terms.");
+    }
+}
+
+inline void stencil_rhs::prepare(std::array<std::size_t, 3> m) const
+{
+    if (m == n && !mt.empty()) return;
+    n = m;
+    std::ptrdiff_t s0 = n[1] * n[2], s1 = n[2];
+    mt.clear();
+    for (auto const& tp : taps)
+        mt.emplace_back(tp.d[0] * s0 + tp.d[1] * s1 + tp.d[2], tp.w);
+    acc.assign(n[2], 0.0);
+}
+
+inline void stencil_rhs::row(double const* ps, std::size_t i, std::size_t j) const
+{
+    // points with full stencil support in this row (none for boundary rows)
+    bool inner =
+        i >= r[0] && i + r[0] < n[0] && j >= r[1] && j + r[1] < n[1] && 2 * r[2] < n[2];
+    std::size_t k0 = inner ? r[2] : 0, k1 = inner ? n[2] - r[2] : 0;
+
+    std::fill(acc.begin(), acc.end(), 0.0);
+    for (auto const& [off, w] : mt) {
+        double const* pt = ps + off;
+        for (std::size_t k = k0; k < k1; ++k)
+            acc[k] += w * pt[k];
+    }
+}
+
+//******************************************************************************
+// dst = alpha*aux + beta*src + gdt*L(src) in one pass (row by row)
+//******************************************************************************
+inline void stencil_rhs::operator()(double, cfield3d_t src, cfield3d_t aux, field3d_t dst,
+                                    double alpha, double beta, double gdt) const
+{
+    std::array<std::size_t, 3> m{src.extent(0), src.extent(1), src.extent(2)};
+    for (int a = 0; a < 3; ++a) {
+        if (aux.extent(a) != m[a] || dst.extent(a) != m[a]) {
+            throw std::invalid_argument("hd::stencil_rhs: extents of fields incompatible.");
+        }
+    }
+    prepare(m);
+    std::ptrdiff_t s0 = n[1] * n[2], s1 = n[2];
+
+    for (std::size_t i = 0; i < n[0]; ++i) {
+        for (std::size_t j = 0; j < n[1]; ++j) {
+            std::ptrdiff_t rw = i * s0 + j * s1;
+            double const* ps = src.data_handle() + rw;
+            double const* pa = aux.data_handle() + rw;
+            double* pd = dst.data_handle() + rw;
+
+            row(ps, i, j);
+            // aux is not read for alpha == 0 (may be uninitialized)
+            if (alpha == 0.0) {
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    pd[k] = beta * ps[k] + gdt * acc[k];
+            }
+            else {
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    pd[k] = alpha * pa[k] + beta * ps[k] + gdt * acc[k];
+            }
+        }
+    }
+}
+
+//******************************************************************************
+// du = a*du + dt*L(u) row by row; plane i - r0 of u is updated (u += b*du) right after
+// plane i of du is complete: later planes of du do not read it anymore
+//******************************************************************************
+inline void stencil_rhs::stage_2n(double, field3d_t u, field3d_t du, double a, double b,
+                                  double dt) const
+{
+    std::array<std::size_t, 3> m{u.extent(0), u.extent(1), u.extent(2)};
+    detail::check_registers(u, du);
+    prepare(m);
+    std::size_t s0 = n[1] * n[2];
+    double* pu = u.data_handle();
+    double* pdu = du.data_handle();
+
+    auto update = [&](std::size_t p) {
+        for (std::size_t q = p * s0; q < (p + 1) * s0; ++q)
+            pu[q] += b * pdu[q];
+    };
+
+    for (std::size_t i = 0; i < n[0]; ++i) {
+        for (std::size_t j = 0; j < n[1]; ++j) {
+            std::size_t rw = i * s0 + j * n[2];
+            row(pu + rw, i, j);
+            double* pd = pdu + rw;
+            // du is not read for a == 0 (may be uninitialized)
+            if (a == 0.0) {
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    pd[k] = dt * acc[k];
+            }
+            else {
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    pd[k] = a * pd[k] + dt * acc[k];
+            }
+        }
+        if (i >= r[0]) update(i - r[0]);
+    }
+    for (std::size_t p = n[0] > r[0] ? n[0] - r[0] : 0; p < n[0]; ++p)
+        update(p);
+}
+
+inline void lsrk_step(lsrk_tableau const& tab, stencil_rhs const& op, double t, double dt,
+                      field3d_t u, field3d_t du)
+{
+    for (int k = 0; k < tab.stages(); ++k)
+        op.stage_2n(t + tab.c[k] * dt, u, du, tab.a[k], tab.b[k], dt);
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_LSRK_H
@@ -0,0 +1,230 @@
+#ifndef HD_STENCIL_METRIC_H
+#define HD_STENCIL_METRIC_H
+
+// derivatives on smoothly stretched grids by grid mapping x = x(xi) (metric terms)
+//
+//   f_x  = f_xi / x_xi
+//   f_xx = f_xixi / x_xi^2 - x_xixi / x_xi^3 * f_xi
+//
+// The derivatives with respect to xi (uniform, spacing 1) use the same NP point weights
+// for all points (compile-time size, from hd::stencil_t), only the metric terms are
+// stored per point (O(N) instead of O(N*NP) for per-point nonuniform stencils).
+// The metric terms x_xi and x_xixi are computed from the grid with the same stencils.
+//
+// Usage:
+//
+// std::vector<double> x = ...;            // stretched grid coordinates, strictly monotone
+// hd::metric_derivative<5> d(x);
+//
+// d.d1(f, df, axis);                      // f, df: mdspan<double (const), E> with
+// d.d2(f, d2f, axis);                     // line length x.size() along axis
+
+#include "hd/hd_stencil.hpp" // hd::stencil_t
+
+#include <array>
+#include <cstddef>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+template <int NP = 5>
+class metric_derivative {
+    static_assert(NP >= 3 && NP % 2 == 1, "hd::metric_derivative: NP must be odd and >= 3.");
+
+  public:
+    metric_derivative(std::vector<double> const& x);
+
+    template <class E>
+    void d1(mdspan<double const, E> f, mdspan<double, E> df, std::size_t axis) const;
+    template <class E>
+    void d2(mdspan<double const, E> f, mdspan<double, E> d2f, std::size_t axis) const;
+    template <class E>
+    void d1(mdspan<double, E> f, mdspan<double, E> df, std::size_t axis) const
+    {
+        d1(mdspan<double const, E>(f), df, axis);
+    }
+    template <class E>
+    void d2(mdspan<double, E> f, mdspan<double, E> d2f, std::size_t axis) const
+    {
+        d2(mdspan<double const, E>(f), d2f, axis);
+    }
+
+    std::size_t size() const { return n; }
+
+    static constexpr int r = NP / 2; // stencil radius
+
+  private:
+    using weights_t = std::array<double, NP>;
+
+    std::size_t n;
+    weights_t w1, w2;                       // interior weights for f_xi and f_xixi
+    std::array<weights_t, 2 * r> b1, b2;    // one-sided closures (r at each boundary)
+    std::vector<double> m1, m2a, m2b;       // 1/x_xi, 1/x_xi^2, -x_xixi/x_xi^3
+
+    weights_t const& weights1(std::size_t i) const;
+    weights_t const& weights2(std::size_t i) const;
+    std::size_t first(std::size_t i) const; // first point of stencil of point i
+
+    template <class E, class Kernel>
+    void apply(mdspan<double const, E> f, mdspan<double, E> out, std::size_t axis,
+               Kernel kernel) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+template <int NP>
+metric_derivative<NP>::metric_derivative(std::vector<double> const& x) :
+    n{x.size()}
+{
+    if (n < NP) {
+        throw std::invalid_argument("hd::metric_derivative: less grid points than stencil points.");
+    }
+
+    // weights with respect to xi for the development point x0 within points 0 ... NP-1
+    auto xi_weights = [](int x0, stencil_lhs lhs_t) {
+        std::vector<double> xf0;
+        for (int j = 0; j < NP; ++j)
+            xf0.push_back(j);
+        stencil_t s = (lhs_t == stencil_lhs::f1)
+                          ? stencil_t(x0, lhs_t, xf0, {double(x0)}, {})
+                          : stencil_t(x0, lhs_t, xf0, {}, {double(x0)});
+        weights_t w;
+        for (int j = 0; j < NP; ++j)
+            w[j] = s.wf0[j];
+        return w;
+    };
+
+    w1 = xi_weights(r, stencil_lhs::f1);
+    w2 = xi_weights(r, stencil_lhs::f2);
+    for (int i = 0; i < r; ++i) {
+        b1[i] = xi_weights(i, stencil_lhs::f1);
+        b2[i] = xi_weights(i, stencil_lhs::f2);
+        b1[r + i] = xi_weights(r + 1 + i, stencil_lhs::f1);
+        b2[r + i] = xi_weights(r + 1 + i, stencil_lhs::f2);
+    }
+
+    // metric terms
+    m1.resize(n);
+    m2a.resize(n);
+    m2b.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double x_xi = 0.0, x_xixi = 0.0;
+        std::size_t j0 = first(i);
+        for (int t = 0; t < NP; ++t) {
+            x_xi += weights1(i)[t] * x[j0 + t];
+            x_xixi += weights2(i)[t] * x[j0 + t];
+        }
+        // zero or sign change of x_xi: grid reverses direction
+        if (x_xi == 0.0 || (i > 0 && (x_xi > 0.0) != (m1[0] > 0.0))) {
+            throw std::invalid_argument("hd::metric_derivative: grid not strictly monotone.");
+        }
+        m1[i] = 1.0 / x_xi;
+        m2a[i] = m1[i] * m1[i];
+        m2b[i] = -x_xixi * m2a[i] * m1[i];
+    }
+}
+
+template <int NP>
+auto metric_derivative<NP>::weights1(std::size_t i) const -> weights_t const&
+{
+    if (i < static_cast<std::size_t>(r)) return b1[i];
+    if (i + r >= n) return b1[r + (i + r - n)];
+    return w1;
+}
+
+template <int NP>
+auto metric_derivative<NP>::weights2(std::size_t i) const -> weights_t const&
+{
+    if (i < static_cast<std::size_t>(r)) return b2[i];
+    if (i + r >= n) return b2[r + (i + r - n)];
+    return w2;
+}
+
+template <int NP>
+std::size_t metric_derivative<NP>::first(std::size_t i) const
+{
+    if (i < static_cast<std::size_t>(r)) return 0;
+    if (i + r >= n) return n - NP;
+    return i - r;
+}
+
+//******************************************************************************
+// apply kernel(i, f_line_at_first_point, stride, out) for all points i of all lines
+//
+// lines along axis with inner extent > 1 are processed point by point for all inner
+// indices at once (contiguous, vectorizable); lines along the last axis are processed
+// with the loop over the points innermost
+//******************************************************************************
+template <int NP>
+template <class E, class Kernel>
+void metric_derivative<NP>::apply(mdspan<double const, E> f, mdspan<double, E> out,
+                                  std::size_t axis, Kernel kernel) const
+{
+    constexpr std::size_t R = E::rank();
+    if (axis >= R || f.extent(axis) != n) {
+        throw std::invalid_argument("hd::metric_derivative: invalid axis or line length.");
+    }
+    std::size_t outer = 1, inner = 1;
+    for (std::size_t a = 0; a < R; ++a) {
+        if (f.extent(a) != out.extent(a)) {
+            throw std::invalid_argument("hd::metric_derivative: extents incompatible.");
+        }
+        if (a < axis) outer *= f.extent(a);
+        if (a > axis) inner *= f.extent(a);
+    }
+
+    for (std::size_t o = 0; o < outer; ++o) {
+        double const* fo = f.data_handle() + o * n * inner;
+        double* po = out.data_handle() + o * n * inner;
+        if (inner == 1) {
+            for (std::size_t i = 0; i < n; ++i)
+                po[i] = kernel(i, fo + first(i), 1);
+        }
+        else {
+            for (std::size_t i = 0; i < n; ++i) {
+                double const* fi = fo + first(i) * inner;
+                double* pi = po + i * inner;
+                for (std::size_t b = 0; b < inner; ++b)
+                    pi[b] = kernel(i, fi + b, inner);
+            }
+        }
+    }
+}
+
+template <int NP>
+template <class E>
+void metric_derivative<NP>::d1(mdspan<double const, E> f, mdspan<double, E> df,
+                               std::size_t axis) const
+{
+    apply(f, df, axis, [this](std::size_t i, double const* p, std::size_t s) {
+        weights_t const& w = weights1(i);
+        double sum = 0.0;
+        for (int t = 0; t < NP; ++t)
+            sum += w[t] * p[t * s];
+        return m1[i] * sum;
+    });
+}
+
+template <int NP>
+template <class E>
+void metric_derivative<NP>::d2(mdspan<double const, E> f, mdspan<double, E> d2f,
+                               std::size_t axis) const
+{
+    apply(f, d2f, axis, [this](std::size_t i, double const* p, std::size_t s) {
+        weights_t const& wa = weights1(i);
+        weights_t const& wb = weights2(i);
+        double sum1 = 0.0, sum2 = 0.0;
+        for (int t = 0; t < NP; ++t) {
+            sum1 += wa[t] * p[t * s];
+            sum2 += wb[t] * p[t * s];
+        }
+        return m2a[i] * sum2 + m2b[i] * sum1;
+    });
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_METRIC_H
@@ -0,0 +1,148 @@
+#ifndef HD_STENCIL_MIXED_H
+#define HD_STENCIL_MIXED_H
+
+// mixed precision application of stencils: values stored in S (e.g. float) to halve the
+// memory traffic, weights and sums kept in the accumulation type A (e.g. double)
+//
+// Usage:
+//
+// std::vector<float> mem_f(n0 * n1 * n2), mem_lap(n0 * n1 * n2);
+// mdspan<float, dextents<std::size_t, 3>> f{mem_f.data(), n0, n1, n2};
+// mdspan<float, dextents<std::size_t, 3>> lap{mem_lap.data(), n0, n1, n2};
+//
+// hd::apply_mixed<float, double>(f, lap, terms);
+//
+// // accuracy of float storage with double accumulation compared to all double
+// hd::precision_report rep = hd::compare_precision<float, double>(f_double, terms);
+
+#include "hd/hd_stencil_apply.hpp" // hd::axis_stencil, hd::merge_terms()
+
+#include <algorithm> // std::max()
+#include <cmath>     // std::abs(), std::sqrt()
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair
+#include <vector>
+
+namespace hd {
+
+// deviation of a result compared to the all double result (interior points only)
+struct precision_report {
+    double max_abs_err{0.0}; // max. absolute error
+    double max_rel_err{0.0}; // max. absolute error relative to max. absolute value of result
+    double rms_err{0.0};     // root mean square of absolute error
+    std::size_t npoints{0};  // number of compared points
+};
+
+template <typename S, typename A = double>
+void apply_mixed(mdspan<S const, dextents<std::size_t, 3>> f,
+                 mdspan<S, dextents<std::size_t, 3>> out, std::span<axis_stencil const> terms);
+
+template <typename S, typename A = double>
+precision_report compare_precision(cfield3d_t f, std::span<axis_stencil const> terms);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+//******************************************************************************
+// out = sum of terms applied to f (interior points only, cmp. hd::apply_fused())
+//
+// Each output row is accumulated in a row buffer of type A: the inner loops only consist
+// of a widening conversion S -> A and a multiply add, i.e. they are vectorized by the
+// compiler. The result is rounded to S once per point.
+//******************************************************************************
+template <typename S, typename A>
+void apply_mixed(mdspan<S const, dextents<std::size_t, 3>> f,
+                 mdspan<S, dextents<std::size_t, 3>> out, std::span<axis_stencil const> terms)
+{
+    std::size_t n[3] = {f.extent(0), f.extent(1), f.extent(2)};
+    if (out.extent(0) != n[0] || out.extent(1) != n[1] || out.extent(2) != n[2] || terms.empty()) {
+        throw std::invalid_argument("hd::apply_mixed(): output extents incompatible or no terms.");
+    }
+    std::ptrdiff_t stride[3] = {static_cast<std::ptrdiff_t>(n[1] * n[2]),
+                                static_cast<std::ptrdiff_t>(n[2]), 1};
+
+    auto r = terms_radius(terms);
+    for (int a = 0; a < 3; ++a) {
+        if (n[a] < 2 * r[a] + 1) return; // no point with full support
+    }
+
+    std::vector<std::pair<std::ptrdiff_t, A>> taps;
+    for (auto const& tp : merge_terms(terms))
+        taps.emplace_back(tp.d[0] * stride[0] + tp.d[1] * stride[1] + tp.d[2], A(tp.w));
+
+    std::size_t k0 = r[2], k1 = n[2] - r[2];
+    std::vector<A> acc(n[2]);
+
+    for (std::size_t i = r[0]; i < n[0] - r[0]; ++i) {
+        for (std::size_t j = r[1]; j < n[1] - r[1]; ++j) {
+            std::ptrdiff_t row = i * stride[0] + j * stride[1];
+            S const* s0 = f.data_handle() + row + taps[0].first;
+            A w0 = taps[0].second;
+            for (std::size_t k = k0; k < k1; ++k)
+                acc[k] = w0 * A(s0[k]);
+            for (std::size_t t = 1; t < taps.size(); ++t) {
+                S const* s = f.data_handle() + row + taps[t].first;
+                A w = taps[t].second;
+                for (std::size_t k = k0; k < k1; ++k)
+                    acc[k] += w * A(s[k]);
+            }
+            S* dst = out.data_handle() + row;
+            for (std::size_t k = k0; k < k1; ++k)
+                dst[k] = S(acc[k]);
+        }
+    }
+}
+
+//******************************************************************************
+// compare apply_mixed<S, A>() with apply_fused() in double precision for field f
+//
+// f is rounded to S first, i.e. the report contains the storage and accumulation error.
+//******************************************************************************
+template <typename S, typename A>
+precision_report compare_precision(cfield3d_t f, std::span<axis_stencil const> terms)
+{
+    std::size_t n[3] = {f.extent(0), f.extent(1), f.extent(2)};
+    std::size_t size = n[0] * n[1] * n[2];
+
+    // reference result
+    std::vector<double> mem_ref(size, 0.0);
+    fused_output fo{field3d_t{mem_ref.data(), n[0], n[1], n[2]},
+                    std::vector<axis_stencil>(terms.begin(), terms.end())};
+    apply_fused(f, std::span<fused_output const>(&fo, 1));
+
+    // mixed precision result
+    std::vector<S> mem_f(size), mem_out(size, S(0));
+    for (std::size_t i = 0; i < size; ++i)
+        mem_f[i] = S(f.data_handle()[i]);
+    apply_mixed<S, A>(mdspan<S const, dextents<std::size_t, 3>>{mem_f.data(), n[0], n[1], n[2]},
+                      mdspan<S, dextents<std::size_t, 3>>{mem_out.data(), n[0], n[1], n[2]},
+                      terms);
+
+    precision_report rep;
+    auto r = terms_radius(terms);
+    for (int a = 0; a < 3; ++a) {
+        if (n[a] < 2 * r[a] + 1) return rep;
+    }
+
+    double max_ref = 0.0, sum_sq = 0.0;
+    for (std::size_t i = r[0]; i < n[0] - r[0]; ++i)
+        for (std::size_t j = r[1]; j < n[1] - r[1]; ++j)
+            for (std::size_t k = r[2]; k < n[2] - r[2]; ++k) {
+                std::size_t p = (i * n[1] + j) * n[2] + k;
+                double err = std::abs(double(mem_out[p]) - mem_ref[p]);
+                rep.max_abs_err = std::max(rep.max_abs_err, err);
+                max_ref = std::max(max_ref, std::abs(mem_ref[p]));
+                sum_sq += err * err;
+                ++rep.npoints;
+            }
+    rep.rms_err = std::sqrt(sum_sq / rep.npoints);
+    rep.max_rel_err = max_ref > 0.0 ? rep.max_abs_err / max_ref : rep.max_abs_err;
+    return rep;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_MIXED_H
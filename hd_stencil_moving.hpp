@@ -0,0 +1,201 @@
+#ifndef HD_STENCIL_MOVING_H
+#define HD_STENCIL_MOVING_H
+
+// stencils on moving grids: incremental update of the weights for shifted points
+//
+// The LU factors of the moment matrix are kept. After the points moved, the update is
+//
+//   1.) skipped, if no point moved (relative to x0) by more than move_tol * extent
+//   2.) refined: w += LU_old^-1 (b - A_new w), repeated while the residual decreases,
+//       i.e. the old factorization is used as preconditioner (O(n^2) instead of O(n^3))
+//   3.) refactored (full setup as hd::stencil_t) if the refinement does not converge
+//       within max_iter iterations
+//
+// Usage:
+//
+// hd::moving_stencil s(x0, hd::stencil_lhs::f1, xf0, {x0}, {});
+// hd::moving_stats stats;
+// for (each time step) {
+//     ... move the points
+//     s.update(x0, xf0, xf1, {}, {}, &stats);
+//     ... use s.wf0(), s.wf1()
+// }
+
+#include "hd/hd_solver.hpp"  // hd::lu_decomp(), hd::lu_backsubs()
+#include "hd/hd_stencil.hpp" // hd::detail::assemble_moment_system()
+
+#include <algorithm> // std::max()
+#include <cmath>     // std::abs()
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+struct moving_param {
+    double move_tol{0.0};    // max. point shift relative to stencil extent to skip the update
+    double res_tol{1.0e-12}; // residual relative to magnitude of terms of each equation
+    int max_iter{8};         // max. refinement iterations before refactoring
+};
+
+enum class moving_update { skipped, refined, refactored };
+
+// accumulated statistics of updates
+struct moving_stats {
+    std::size_t skipped{0};
+    std::size_t refined{0};
+    std::size_t refactored{0};
+    std::size_t iterations{0}; // total number of refinement iterations
+};
+
+class moving_stencil {
+  public:
+    moving_stencil(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                   std::span<double const> xf1, std::span<double const> xf2);
+
+    // new coordinates of the points (same number of points as in ctor)
+    moving_update update(double x0, std::span<double const> xf0, std::span<double const> xf1,
+                         std::span<double const> xf2, moving_param const& par = {},
+                         moving_stats* stats = nullptr);
+
+    std::span<double const> wf0() const { return {w.data(), std::size_t(nf[0])}; }
+    std::span<double const> wf1() const { return {w.data() + nf[0], std::size_t(nf[1])}; }
+    std::span<double const> wf2() const { return {w.data() + nf[0] + nf[1], std::size_t(nf[2])}; }
+
+    int n() const { return nf[0] + nf[1] + nf[2]; }
+
+  private:
+    stencil_lhs lhs_t;
+    int nf[3];
+    std::vector<double> dx;   // coordinates relative to x0 at the last refinement/refactoring
+    std::vector<double> w;    // weights
+    std::vector<double> mem_lu, mem_a, mem_b, mem_r, mem_vv;
+    std::vector<int> mem_perm;
+
+    void refactor(double x0, std::span<double const> xf0, std::span<double const> xf1,
+                  std::span<double const> xf2);
+    void store_dx(double x0, std::span<double const> xf0, std::span<double const> xf1,
+                  std::span<double const> xf2);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline moving_stencil::moving_stencil(double x0, stencil_lhs lhs_t, std::span<double const> xf0,
+                                      std::span<double const> xf1,
+                                      std::span<double const> xf2) :
+    lhs_t{lhs_t}, nf{int(xf0.size()), int(xf1.size()), int(xf2.size())}
+{
+    if ((nf[1] == 0 && nf[2] == 0) || n() < 3 || (nf[1] == 0 && lhs_t == stencil_lhs::f1) ||
+        (nf[2] == 0 && lhs_t == stencil_lhs::f2)) {
+        throw std::invalid_argument("Inconsistent specification of stencil in ctor of hd::moving_stencil.");
+    }
+    std::size_t nn = n();
+    dx.resize(nn);
+    w.resize(nn);
+    mem_lu.resize(nn * nn);
+    mem_a.resize(nn * nn);
+    mem_b.resize(nn);
+    mem_r.resize(nn);
+    mem_vv.resize(nn);
+    mem_perm.resize(nn);
+
+    refactor(x0, xf0, xf1, xf2);
+}
+
+inline void moving_stencil::store_dx(double x0, std::span<double const> xf0,
+                                     std::span<double const> xf1, std::span<double const> xf2)
+{
+    std::size_t j = 0;
+    for (auto xs : {xf0, xf1, xf2})
+        for (double x : xs)
+            dx[j++] = x - x0;
+}
+
+inline void moving_stencil::refactor(double x0, std::span<double const> xf0,
+                                     std::span<double const> xf1, std::span<double const> xf2)
+{
+    std::size_t nn = n();
+    mdspan lu{mem_lu.data(), nn, nn};
+    mdspan<int, dextents<std::size_t, 1>> perm{mem_perm.data(), nn};
+    mdspan<double, dextents<std::size_t, 1>> rhs{w.data(), nn};
+
+    detail::assemble_moment_system(x0, lhs_t, xf0, xf1, xf2, lu, rhs);
+    lu_decomp(lu, perm, mdspan{mem_vv.data(), nn});
+    lu_backsubs(lu, perm, rhs);
+    store_dx(x0, xf0, xf1, xf2);
+}
+
+inline moving_update moving_stencil::update(double x0, std::span<double const> xf0,
+                                            std::span<double const> xf1,
+                                            std::span<double const> xf2, moving_param const& par,
+                                            moving_stats* stats)
+{
+    if (int(xf0.size()) != nf[0] || int(xf1.size()) != nf[1] || int(xf2.size()) != nf[2]) {
+        throw std::invalid_argument("hd::moving_stencil::update(): number of points changed.");
+    }
+    moving_stats dummy;
+    moving_stats& st = stats ? *stats : dummy;
+    std::size_t nn = n();
+
+    // 1.) skip for small shifts
+    double shift = 0.0, extent = 0.0;
+    std::size_t j = 0;
+    for (auto xs : {xf0, xf1, xf2})
+        for (double x : xs) {
+            shift = std::max(shift, std::abs(x - x0 - dx[j]));
+            extent = std::max(extent, std::abs(dx[j]));
+            ++j;
+        }
+    if (shift <= par.move_tol * extent) {
+        ++st.skipped;
+        return moving_update::skipped;
+    }
+
+    // 2.) iterative refinement with the old factorization
+    mdspan a{mem_a.data(), nn, nn};
+    mdspan<double, dextents<std::size_t, 1>> b{mem_b.data(), nn};
+    mdspan<double, dextents<std::size_t, 1>> r{mem_r.data(), nn};
+    mdspan<double const, dextents<std::size_t, 2>> lu{mem_lu.data(), nn, nn};
+    mdspan<int const, dextents<std::size_t, 1>> perm{mem_perm.data(), nn};
+
+    detail::assemble_moment_system(x0, lhs_t, xf0, xf1, xf2, a, b);
+
+    double res_prev = 0.0;
+    for (int it = 0;; ++it) {
+        // residual r = b - a w, relative to the magnitude of the terms of each row
+        double res = 0.0;
+        for (std::size_t i = 0; i < nn; ++i) {
+            double sum = b[i], mag = std::abs(b[i]);
+            for (std::size_t k = 0; k < nn; ++k) {
+                sum -= a[i, k] * w[k];
+                mag += std::abs(a[i, k] * w[k]);
+            }
+            r[i] = sum;
+            if (mag > 0.0) res = std::max(res, std::abs(sum) / mag);
+        }
+        if (res <= par.res_tol) {
+            store_dx(x0, xf0, xf1, xf2);
+            ++st.refined;
+            return moving_update::refined;
+        }
+        if (it == par.max_iter || (it > 0 && res >= res_prev)) break; // not converging
+        res_prev = res;
+
+        lu_backsubs(lu, perm, r);
+        for (std::size_t i = 0; i < nn; ++i)
+            w[i] += r[i];
+        ++st.iterations;
+    }
+
+    // 3.) fallback: new factorization
+    refactor(x0, xf0, xf1, xf2);
+    ++st.refactored;
+    return moving_update::refactored;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_MOVING_H
@@ -0,0 +1,120 @@
+#ifndef HD_STENCIL_RICHARDSON_H
+#define HD_STENCIL_RICHARDSON_H
+
+// richardson extrapolation of explicit stencils on uniform grids
+//
+// The stencil is applied to the same field with spacings h, 2h (and 4h) by strided access,
+//
+//   D(m h) = D + C (m h)^p + C' (m h)^(p+q) + ...   (p: order of stencil_t, q = 2 for
+//                                                    (anti)symmetric stencils, else q = 1)
+//
+// and the results are combined such that the leading error terms cancel. As all levels
+// are linear in f, the combination is itself a single (wider) stencil, i.e. it is applied
+// in one fused pass. The difference of the result at spacing h and the extrapolated result
+// serves as error estimate of the former.
+//
+// Usage:
+//
+// hd::stencil_t s(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {});
+// auto rw = hd::richardson_weights(s, h, 3);    // order 2 -> 6
+//
+// std::vector<hd::fused_output> out{{df, {{axis, rw.w}}}, {err, {{axis, rw.err}}}};
+// hd::apply_fused(f, out);
+
+#include "hd/hd_solver.hpp"        // hd::lu_decomp(), hd::lu_backsubs()
+#include "hd/hd_stencil_apply.hpp" // hd::stencil_weights
+
+#include <algorithm> // std::max()
+#include <cmath>     // std::pow(), std::abs()
+#include <cstddef>
+#include <map>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+struct richardson_t {
+    stencil_weights w;   // extrapolated stencil (all levels combined)
+    stencil_weights err; // error estimate of the result with spacing h: D(h) - extrapolated
+    int order;           // expected order of the extrapolated stencil
+    std::vector<double> c; // combination coefficients of the levels h, 2h, 4h, ...
+};
+
+// levels: number of spacings h, 2h, ..., 2^(levels-1) h (2 or 3)
+richardson_t richardson_weights(stencil_t const& s, double h, int levels = 3);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline richardson_t richardson_weights(stencil_t const& s, double h, int levels)
+{
+    if (levels < 2 || levels > 3) {
+        throw std::invalid_argument("hd::richardson_weights(): levels must be 2 or 3.");
+    }
+    stencil_weights base(s, h); // checks for explicit stencil on the grid
+    int d = (s.lhs_t == stencil_lhs::f1) ? 1 : 2;
+    int p = s.order();
+
+    // (anti)symmetric stencils have even error expansions (tolerance relative to the
+    // largest weight: a center weight of rounding size must not break the symmetry)
+    std::map<int, double> wb;
+    for (int j = 0; j < base.size(); ++j)
+        wb[base.offset[j]] += base.weight[j];
+    double wmax = 0.0;
+    for (auto const& [o, w] : wb)
+        wmax = std::max(wmax, std::abs(w));
+    bool sym = true;
+    double sign = (d % 2 == 0) ? 1.0 : -1.0;
+    for (auto const& [o, w] : wb) {
+        auto it = wb.find(-o);
+        double wm = (it == wb.end()) ? 0.0 : it->second;
+        if (std::abs(w - sign * wm) > 1.0e-12 * wmax) sym = false;
+    }
+    int q = sym ? 2 : 1;
+
+    // coefficients: sum c_l = 1, sum c_l m_l^(p + k q) = 0 for k = 0 ... levels-2
+    std::vector<double> mem_m(levels * levels), c(levels, 0.0);
+    std::vector<int> mem_perm(levels);
+    mdspan m{mem_m.data(), levels, levels};
+    mdspan perm{mem_perm.data(), levels};
+    for (int l = 0; l < levels; ++l) {
+        double ml = std::pow(2.0, l);
+        m[0, l] = 1.0;
+        for (int k = 0; k < levels - 1; ++k)
+            m[k + 1, l] = std::pow(ml, p + k * q);
+    }
+    c[0] = 1.0;
+    lu_decomp(m, perm);
+    lu_backsubs(m, perm, mdspan{c.data(), c.size()});
+
+    // combined stencil: level l has offsets m_l * o and weights w / m_l^d
+    std::map<int, double> wr;
+    for (int l = 0; l < levels; ++l) {
+        int ml = 1 << l;
+        double f = c[l] / std::pow(ml, d);
+        for (int j = 0; j < base.size(); ++j)
+            wr[ml * base.offset[j]] += f * base.weight[j];
+    }
+    std::map<int, double> we = wr;
+    for (auto& [o, w] : we)
+        w = -w;
+    for (auto const& [o, w] : wb)
+        we[o] += w;
+
+    auto to_weights = [](std::map<int, double> const& mp) {
+        std::vector<int> off;
+        std::vector<double> w;
+        for (auto const& [o, v] : mp) {
+            off.push_back(o);
+            w.push_back(v);
+        }
+        return stencil_weights(off, w);
+    };
+
+    return {to_weights(wr), to_weights(we), p + (levels - 1) * q, c};
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_RICHARDSON_H
@@ -0,0 +1,389 @@
+#ifndef HD_STENCIL_SHM_H
+#define HD_STENCIL_SHM_H
+
+// halo exchange between processes of one node through POSIX shared memory (no MPI)
+//
+// Each process owns a slab of planes along axis 0 of a 3D field (plus ghost planes of the
+// stencil radius r0 towards its neighbours). Neighbouring processes exchange their
+// boundary planes through single producer / single consumer ring buffers in shared memory
+// segments (shm_open), one per direction. The producer creates (and finally removes) the
+// segment, the consumer attaches to it.
+//
+// advance_shm() performs euler steps (cmp. hd::advance()) and overlaps the exchange with
+// the computation: the boundary planes of the current state are sent, the core of the
+// slab (not depending on ghost planes) is computed, and only then the ghost planes are
+// received and the planes next to them are computed.
+//
+// The rings use lock-free std::atomic counters in the shared segment and spin (with
+// std::this_thread::yield()) while empty or full; waiting longer than the timeout throws,
+// i.e. a failing neighbour process does not block the others forever.
+//
+// The prefix of the segment names should be unique per run (e.g. contain a job id): a
+// consumer might attach to a segment left over by a crashed run otherwise.
+//
+// Usage (process p of np):
+//
+// hd::shm_halo_exchange ex("/myrun", n0, n1 * n2, np, p, r0);
+// auto sl = ex.slab();                                   // planes i0 ... i1-1 of the field
+// std::vector<double> mem(sl.planes() * n1 * n2);        // incl. ghost planes
+// hd::field3d_t u{mem.data(), sl.planes(), n1, n2};     // ... initialize
+// hd::advance_shm(u, lap, dt, nsteps, ex);
+
+#include "hd/hd_stencil_apply.hpp"     // hd::axis_stencil
+#include "hd/hd_stencil_timeblock.hpp" // hd::detail::euler_step_raw()
+
+#include <fcntl.h>    // O_CREAT, O_RDWR, O_EXCL
+#include <sys/mman.h> // shm_open(), shm_unlink(), mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close(), ftruncate()
+
+#include <algorithm> // std::min(), std::max(), std::copy()
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::strerror()
+#include <new>     // placement new
+#include <span>
+#include <stdexcept> // std::runtime_error, std::invalid_argument
+#include <string>
+#include <thread>  // std::this_thread::yield()
+#include <utility> // std::exchange(), std::swap()
+#include <vector>
+
+namespace hd {
+
+// single producer / single consumer ring of fixed size messages (double values)
+class shm_ring {
+  public:
+    // producer side: creates the segment (removed again by the destructor)
+    static shm_ring create(std::string const& name, std::size_t nslots, std::size_t slot_size);
+    // consumer side: waits up to timeout for the producer to create the segment
+    static shm_ring open(std::string const& name,
+                         std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
+    ~shm_ring();
+    shm_ring(shm_ring const&) = delete;
+    shm_ring& operator=(shm_ring const&) = delete;
+    shm_ring(shm_ring&& other) noexcept;
+    shm_ring& operator=(shm_ring&& other) noexcept;
+
+    // block while the ring is full/empty (at most timeout)
+    void push(std::span<double const> msg,
+              std::chrono::milliseconds timeout = std::chrono::seconds(30));
+    void pop(std::span<double> msg, std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
+    std::size_t slot_size() const { return hdr->slot_size; }
+
+  private:
+    static constexpr std::uint64_t magic = 0x68645f72696e6731; // "hd_ring1"
+
+    struct header {
+        alignas(64) std::atomic<std::uint64_t> head; // messages pushed (producer)
+        alignas(64) std::atomic<std::uint64_t> tail; // messages popped (consumer)
+        alignas(64) std::atomic<std::uint64_t> ready;
+        std::uint64_t nslots;
+        std::uint64_t slot_size;
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+    shm_ring() = default;
+    void map(int fd, std::size_t bytes, std::string const& name);
+
+    header* hdr{nullptr};
+    double* slots{nullptr};
+    std::size_t bytes{0};
+    std::string name; // non-empty for the producer (unlinks the segment)
+};
+
+// planes [i0, i1) of axis 0 owned by a process, hlo/hhi ghost planes below/above
+struct slab_t {
+    std::size_t i0, i1, hlo, hhi;
+
+    std::size_t planes() const { return i1 - i0 + hlo + hhi; } // local planes incl. ghosts
+};
+
+// slab of process p of np (slabs differ in size by one plane at most)
+slab_t slab_of(std::size_t n0, unsigned np, unsigned p, std::size_t r0);
+
+class shm_halo_exchange {
+  public:
+    // plane: values per plane (n1 * n2), r0: stencil radius in axis 0, depth: messages
+    // the sender may run ahead of the receiver
+    shm_halo_exchange(std::string const& prefix, std::size_t n0, std::size_t plane, unsigned np,
+                      unsigned p, std::size_t r0, std::size_t depth = 2,
+                      std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
+    slab_t slab() const { return sl; }
+    std::size_t extent0() const { return n0; }
+    std::size_t radius0() const { return r0; }
+    std::size_t plane() const { return nplane; } // values per plane (n1 * n2)
+
+    // send the boundary planes of the local field to the neighbours
+    void send(double const* local);
+    // receive the ghost planes of the local field from the neighbours
+    void receive(double* local);
+
+  private:
+    std::size_t n0, nplane, r0;
+    slab_t sl;
+    std::chrono::milliseconds timeout;
+    std::vector<shm_ring> out_lo, out_hi, in_lo, in_hi; // empty if no neighbour
+};
+
+// nsteps euler steps on the local field of the slab (extents {slab().planes(), n1, n2})
+void advance_shm(field3d_t u, std::span<axis_stencil const> terms, double dt, std::size_t nsteps,
+                 shm_halo_exchange& ex);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline void shm_ring::map(int fd, std::size_t nbytes, std::string const& nm)
+{
+    void* p = ::mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("hd::shm_ring: cannot map '" + nm + "': " + std::strerror(err));
+    }
+    ::close(fd); // mapping stays valid
+    hdr = static_cast<header*>(p);
+    slots = reinterpret_cast<double*>(static_cast<char*>(p) + sizeof(header));
+    bytes = nbytes;
+}
+
+inline shm_ring shm_ring::create(std::string const& name, std::size_t nslots,
+                                 std::size_t slot_size)
+{
+    if (nslots == 0 || slot_size == 0) {
+        throw std::invalid_argument("hd::shm_ring::create(): nslots == 0 or slot_size == 0.");
+    }
+    ::shm_unlink(name.c_str()); // left over by a previous (crashed) run
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("hd::shm_ring: cannot create '" + name + "': " + std::strerror(errno));
+    }
+    std::size_t nbytes = sizeof(header) + nslots * slot_size * sizeof(double);
+    if (::ftruncate(fd, nbytes) != 0) {
+        int err = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("hd::shm_ring: cannot resize '" + name + "': " + std::strerror(err));
+    }
+    shm_ring r;
+    r.map(fd, nbytes, name);
+    r.name = name;
+    r.hdr = new (r.hdr) header{};
+    r.hdr->nslots = nslots;
+    r.hdr->slot_size = slot_size;
+    r.hdr->ready.store(magic, std::memory_order_release); // header complete
+    return r;
+}
+
+inline shm_ring shm_ring::open(std::string const& name, std::chrono::milliseconds timeout)
+{
+    auto t_end = std::chrono::steady_clock::now() + timeout;
+    auto expired = [&](char const* what) {
+        if (std::chrono::steady_clock::now() > t_end) {
+            throw std::runtime_error("hd::shm_ring: timeout, " + std::string(what) + " '" + name + "'.");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    // segment created and resized by the producer
+    int fd;
+    while ((fd = ::shm_open(name.c_str(), O_RDWR, 0600)) < 0)
+        expired("cannot open");
+    struct stat st;
+    for (;;) {
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("hd::shm_ring: cannot stat '" + name + "': " + std::strerror(err));
+        }
+        if (std::size_t(st.st_size) >= sizeof(header)) break;
+        try {
+            expired("segment not initialized");
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    shm_ring r;
+    r.map(fd, st.st_size, name);
+    while (r.hdr->ready.load(std::memory_order_acquire) != magic)
+        expired("segment not initialized");
+    return r;
+}
+
+inline shm_ring::~shm_ring()
+{
+    if (hdr) ::munmap(hdr, bytes);
+    if (!name.empty()) ::shm_unlink(name.c_str());
+}
+
+inline shm_ring::shm_ring(shm_ring&& other) noexcept :
+    hdr{std::exchange(other.hdr, nullptr)}, slots{std::exchange(other.slots, nullptr)},
+    bytes{std::exchange(other.bytes, 0)}, name{std::exchange(other.name, {})}
+{
+}
+
+inline shm_ring& shm_ring::operator=(shm_ring&& other) noexcept
+{
+    if (this != &other) {
+        if (hdr) ::munmap(hdr, bytes);
+        if (!name.empty()) ::shm_unlink(name.c_str());
+        hdr = std::exchange(other.hdr, nullptr);
+        slots = std::exchange(other.slots, nullptr);
+        bytes = std::exchange(other.bytes, 0);
+        name = std::exchange(other.name, {});
+    }
+    return *this;
+}
+
+namespace detail {
+
+// spin until pred() holds (yielding, checking the clock every 1024 iterations)
+template <class P>
+void spin_until(P const& pred, std::chrono::milliseconds timeout, char const* msg)
+{
+    auto t_end = std::chrono::steady_clock::now() + timeout;
+    for (unsigned k = 1; !pred(); ++k) {
+        std::this_thread::yield();
+        if (k % 1024 == 0 && std::chrono::steady_clock::now() > t_end) {
+            throw std::runtime_error(msg);
+        }
+    }
+}
+
+} // namespace detail
+
+inline void shm_ring::push(std::span<double const> msg, std::chrono::milliseconds timeout)
+{
+    if (msg.size() > hdr->slot_size) {
+        throw std::invalid_argument("hd::shm_ring::push(): message larger than slot.");
+    }
+    std::uint64_t h = hdr->head.load(std::memory_order_relaxed);
+    detail::spin_until(
+        [&] { return h - hdr->tail.load(std::memory_order_acquire) < hdr->nslots; }, timeout,
+        "hd::shm_ring::push(): timeout, ring full.");
+    std::copy(msg.begin(), msg.end(), slots + (h % hdr->nslots) * hdr->slot_size);
+    hdr->head.store(h + 1, std::memory_order_release);
+}
+
+inline void shm_ring::pop(std::span<double> msg, std::chrono::milliseconds timeout)
+{
+    if (msg.size() > hdr->slot_size) {
+        throw std::invalid_argument("hd::shm_ring::pop(): message larger than slot.");
+    }
+    std::uint64_t t = hdr->tail.load(std::memory_order_relaxed);
+    detail::spin_until([&] { return hdr->head.load(std::memory_order_acquire) != t; }, timeout,
+                       "hd::shm_ring::pop(): timeout, ring empty.");
+    double const* s = slots + (t % hdr->nslots) * hdr->slot_size;
+    std::copy(s, s + msg.size(), msg.begin());
+    hdr->tail.store(t + 1, std::memory_order_release);
+}
+
+inline slab_t slab_of(std::size_t n0, unsigned np, unsigned p, std::size_t r0)
+{
+    if (np == 0 || p >= np || n0 < np * std::max<std::size_t>(r0, 1)) {
+        throw std::invalid_argument("hd::slab_of(): invalid process or slabs smaller than r0.");
+    }
+    std::size_t chunk = n0 / np, rest = n0 % np;
+    auto begin = [&](unsigned t) { return t * chunk + std::min<std::size_t>(t, rest); };
+    std::size_t i0 = begin(p), i1 = begin(p + 1);
+    return {i0, i1, std::min(r0, i0), std::min(r0, n0 - i1)};
+}
+
+//******************************************************************************
+// rings are named <prefix>_<from>_<to>; outgoing rings are created first (no blocking),
+// then the incoming rings of the neighbours are attached
+//******************************************************************************
+inline shm_halo_exchange::shm_halo_exchange(std::string const& prefix, std::size_t n0,
+                                            std::size_t plane, unsigned np, unsigned p,
+                                            std::size_t r0, std::size_t depth,
+                                            std::chrono::milliseconds timeout) :
+    n0{n0}, nplane{plane}, r0{r0}, sl{slab_of(n0, np, p, r0)}, timeout{timeout}
+{
+    auto ring_name = [&](unsigned from, unsigned to) {
+        return prefix + "_" + std::to_string(from) + "_" + std::to_string(to);
+    };
+    if (r0 == 0) return; // nothing to exchange
+    std::size_t msg = r0 * plane;
+    if (sl.hlo > 0) out_lo.push_back(shm_ring::create(ring_name(p, p - 1), depth, msg));
+    if (sl.hhi > 0) out_hi.push_back(shm_ring::create(ring_name(p, p + 1), depth, msg));
+    if (sl.hlo > 0) in_lo.push_back(shm_ring::open(ring_name(p - 1, p), timeout));
+    if (sl.hhi > 0) in_hi.push_back(shm_ring::open(ring_name(p + 1, p), timeout));
+}
+
+inline void shm_halo_exchange::send(double const* local)
+{
+    std::size_t m0 = sl.planes();
+    if (!out_lo.empty())
+        out_lo[0].push({local + sl.hlo * nplane, r0 * nplane}, timeout);
+    if (!out_hi.empty())
+        out_hi[0].push({local + (m0 - sl.hhi - r0) * nplane, r0 * nplane}, timeout);
+}
+
+inline void shm_halo_exchange::receive(double* local)
+{
+    std::size_t m0 = sl.planes();
+    if (!in_lo.empty()) in_lo[0].pop({local, r0 * nplane}, timeout);
+    if (!in_hi.empty()) in_hi[0].pop({local + (m0 - sl.hhi) * nplane, r0 * nplane}, timeout);
+}
+
+inline void advance_shm(field3d_t u, std::span<axis_stencil const> terms, double dt,
+                        std::size_t nsteps, shm_halo_exchange& ex)
+{
+    slab_t sl = ex.slab();
+    std::array<std::size_t, 3> m{u.extent(0), u.extent(1), u.extent(2)};
+    auto r = terms_radius(terms);
+    if (terms.empty() || m[0] != sl.planes() || m[1] * m[2] != ex.plane() ||
+        r[0] > ex.radius0()) {
+        throw std::invalid_argument("hd::advance_shm(): no terms, extents or stencil radius inconsistent with slab.");
+    }
+    if (nsteps == 0) return;
+
+    // interior of the global field in local plane indices of axis 0
+    std::size_t g0 = sl.i0 - sl.hlo;
+    auto in = detail::interior({ex.extent0(), m[1], m[2]}, r);
+    std::size_t lo = std::max(in.lo[0], sl.i0) - g0;
+    std::size_t hi = std::max(std::min(in.hi[0], sl.i1), std::max(in.lo[0], sl.i0)) - g0;
+
+    // core: planes without ghost planes in their stencil support
+    std::size_t a = sl.hlo + (sl.hlo > 0 ? r[0] : 0);
+    std::size_t b = std::max(a, m[0] - sl.hhi - (sl.hhi > 0 ? r[0] : 0));
+
+    auto taps = detail::memory_taps(merge_terms(terms), m);
+    auto step = [&](double const* src, double* dst, std::size_t p0, std::size_t p1) {
+        p0 = std::max(p0, lo);
+        p1 = std::min(p1, hi);
+        if (p0 >= p1 || in.lo[1] >= in.hi[1] || in.lo[2] >= in.hi[2]) return;
+        detail::euler_step_raw(src, dst, m, taps, dt,
+                               {{p0, in.lo[1], in.lo[2]}, {p1, in.hi[1], in.hi[2]}});
+    };
+
+    std::vector<double> work(u.data_handle(), u.data_handle() + u.size());
+    double* cur = u.data_handle();
+    double* nxt = work.data();
+    for (std::size_t s = 0; s < nsteps; ++s) {
+        ex.send(cur);
+        step(cur, nxt, a, b);                   // overlapped with the exchange
+        ex.receive(cur);
+        step(cur, nxt, sl.hlo, a);              // planes next to the ghost planes
+        step(cur, nxt, b, m[0] - sl.hhi);
+        std::swap(cur, nxt);
+    }
+    if (cur != u.data_handle()) {
+        std::copy(cur, cur + u.size(), u.data_handle());
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_SHM_H
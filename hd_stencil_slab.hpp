@@ -0,0 +1,280 @@
+#ifndef HD_STENCIL_SLAB_H
+#define HD_STENCIL_SLAB_H
+
+// explicit stencil sweeps (euler steps u_new = u + dt*L(u), cmp. hd::advance()) on a 3D
+// field decomposed into slabs along axis 0 (shared memory, one thread per slab)
+//
+// hd::slab_field holds the field persistently in slab-owned buffers: each slab keeps two
+// state buffers incl. r0 ghost planes on each side, allocated and initialized by the thread
+// working on that slab, i.e. on systems with several NUMA domains the memory is placed on
+// the domain of that thread by first touch. The slabs are assigned to the threads of
+// hd::parallel_for() in the same way in every call; for the placement to pay off the
+// threads should be pinned (e.g. by taskset/numactl or the affinity settings of the
+// process). scatter() and gather() copy from/to a global field; repeated calls of advance()
+// work on the slab buffers only.
+//
+// Only the ghost planes are exchanged between neighbouring slabs; there is no global
+// barrier per time step:
+//
+//   ready[t]:       number of states published by slab t (state s is ready if ready[t] > s)
+//   consumed[t][k]: number of states of slab t read by its lower (k = 0) / upper neighbour
+//
+// A slab waits (std::atomic wait/notify) for its neighbours to publish state s before it
+// copies their boundary planes, and before computing state s+1 into the buffer of state
+// s-1 it waits until both neighbours have read that state. Slabs may thus run up to one
+// time step apart. The result is identical to hd::advance().
+//
+// hd::advance_slabs() is the one-shot version (scatter, advance, gather) for a single run.
+//
+// Usage:
+//
+// std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+// hd::slab_field f({n0, n1, n2}, hd::terms_radius(lap)[0]); // one slab per hardware thread
+// f.scatter(u);
+// for (...) {
+//     f.advance(lap, dt, nsteps);
+//     f.gather(u);                                           // e.g. for output
+// }
+//
+// hd::advance_slabs(u, lap, dt, nsteps);
+
+#include "hd/hd_parallel.hpp"         // hd::parallel_for(), hd::default_threads()
+#include "hd/hd_stencil_apply.hpp"    // hd::axis_stencil
+#include "hd/hd_stencil_timeblock.hpp" // hd::detail::euler_step_raw()
+
+#include <algorithm> // std::min(), std::max(), std::copy()
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+class slab_field {
+  public:
+    // n: extents of the global field, r0: ghost planes (max. stencil radius in axis 0)
+    // nslabs == 0: hd::default_threads() slabs (reduced such that every slab has at least
+    // r0 planes)
+    slab_field(std::array<std::size_t, 3> n, std::size_t r0, unsigned nslabs = 0);
+
+    std::array<std::size_t, 3> extents() const { return n; }
+    std::size_t radius0() const { return r0; }
+    unsigned slabs() const { return nslabs; }
+
+    // copy the global field u (extents()) into the slabs
+    void scatter(field3d_t u);
+    // copy the slabs (without ghost planes) into the global field u (extents())
+    void gather(field3d_t u) const;
+    // nsteps euler steps; the radius of terms in axis 0 must not exceed radius0()
+    void advance(std::span<axis_stencil const> terms, double dt, std::size_t nsteps);
+
+  private:
+    struct slab {
+        std::size_t i0, i1, hlo, hhi;              // planes i0 ... i1-1, ghost planes
+        std::array<std::vector<double>, 2> buf;    // states, local plane 0 is i0 - hlo
+        std::size_t planes() const { return hlo + i1 - i0 + hhi; }
+    };
+
+    // f(t) for every slab t, on the thread working on slab t
+    template <class F>
+    void for_slabs(F&& f) const;
+
+    std::array<std::size_t, 3> n;
+    std::size_t r0, nplane;
+    unsigned nslabs;
+    std::vector<slab> sl;
+    unsigned cur{0}; // buffer holding the current state
+    std::vector<std::atomic<std::size_t>> ready;
+    std::vector<std::array<std::atomic<std::size_t>, 2>> consumed;
+};
+
+// nsteps euler steps on u; nslabs == 0: hd::default_threads() slabs (reduced such that
+// every slab has at least as many planes as the stencil radius in axis 0)
+void advance_slabs(field3d_t u, std::span<axis_stencil const> terms, double dt,
+                   std::size_t nsteps, unsigned nslabs = 0);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+template <class F>
+void slab_field::for_slabs(F&& f) const
+{
+    parallel_for(
+        nslabs,
+        [&](std::size_t t0, std::size_t t1, unsigned) {
+            for (std::size_t t = t0; t < t1; ++t)
+                f(static_cast<unsigned>(t));
+        },
+        nslabs);
+}
+
+inline slab_field::slab_field(std::array<std::size_t, 3> n, std::size_t r0, unsigned nslabs)
+    : n(n), r0(r0), nplane(n[1] * n[2])
+{
+    if (nslabs == 0) nslabs = default_threads();
+    std::size_t max_slabs = r0 > 0 ? n[0] / r0 : n[0];
+    this->nslabs = static_cast<unsigned>(
+        std::max<std::size_t>(1, std::min<std::size_t>(nslabs, max_slabs)));
+    ready = std::vector<std::atomic<std::size_t>>(this->nslabs);
+    consumed = std::vector<std::array<std::atomic<std::size_t>, 2>>(this->nslabs);
+
+    std::size_t chunk = n[0] / this->nslabs, rest = n[0] % this->nslabs;
+    auto begin = [&](unsigned t) { return t * chunk + std::min<std::size_t>(t, rest); };
+    sl.resize(this->nslabs);
+    for (unsigned t = 0; t < this->nslabs; ++t) {
+        sl[t].i0 = begin(t);
+        sl[t].i1 = begin(t + 1);
+        sl[t].hlo = std::min(r0, sl[t].i0);
+        sl[t].hhi = std::min(r0, n[0] - sl[t].i1);
+    }
+    // first touch by the thread working on the slab
+    for_slabs([this](unsigned t) {
+        for (auto& b : sl[t].buf)
+            b.assign(sl[t].planes() * nplane, 0.0);
+    });
+}
+
+inline void slab_field::scatter(field3d_t u)
+{
+    if (u.extent(0) != n[0] || u.extent(1) != n[1] || u.extent(2) != n[2]) {
+        throw std::invalid_argument("hd::slab_field::scatter(): extents do not match.");
+    }
+    // boundary values are needed in both buffers
+    for_slabs([&](unsigned t) {
+        double const* src = u.data_handle() + (sl[t].i0 - sl[t].hlo) * nplane;
+        for (auto& b : sl[t].buf)
+            std::copy(src, src + b.size(), b.begin());
+    });
+}
+
+inline void slab_field::gather(field3d_t u) const
+{
+    if (u.extent(0) != n[0] || u.extent(1) != n[1] || u.extent(2) != n[2]) {
+        throw std::invalid_argument("hd::slab_field::gather(): extents do not match.");
+    }
+    for_slabs([&](unsigned t) {
+        slab const& s = sl[t];
+        double const* src = s.buf[cur].data() + s.hlo * nplane;
+        std::copy(src, src + (s.i1 - s.i0) * nplane, u.data_handle() + s.i0 * nplane);
+    });
+}
+
+inline void slab_field::advance(std::span<axis_stencil const> terms, double dt, std::size_t nsteps)
+{
+    if (terms.empty()) {
+        throw std::invalid_argument("hd::slab_field::advance(): no terms.");
+    }
+    auto r = terms_radius(terms);
+    if (r[0] > r0) {
+        throw std::invalid_argument("hd::slab_field::advance(): stencil radius exceeds ghost planes.");
+    }
+    if (nsteps == 0) return;
+
+    auto in = detail::interior(n, r);
+    auto taps = merge_terms(terms);
+    for (unsigned t = 0; t < nslabs; ++t) {
+        ready[t].store(0, std::memory_order_relaxed);
+        consumed[t][0].store(0, std::memory_order_relaxed);
+        consumed[t][1].store(0, std::memory_order_relaxed);
+    }
+    std::atomic<bool> failed{false};
+
+    // returns false if another slab failed
+    auto wait_for = [&](std::atomic<std::size_t>& c, std::size_t v) {
+        std::size_t x;
+        while ((x = c.load(std::memory_order_acquire)) < v && !failed.load(std::memory_order_acquire))
+            c.wait(x, std::memory_order_acquire);
+        return !failed.load(std::memory_order_acquire);
+    };
+    auto publish = [](std::atomic<std::size_t>& c, std::size_t v) {
+        c.store(v, std::memory_order_release);
+        c.notify_all();
+    };
+    auto count = [](std::atomic<std::size_t>& c) {
+        c.fetch_add(1, std::memory_order_release);
+        c.notify_all();
+    };
+    auto fail = [&]() {
+        failed.store(true, std::memory_order_release);
+        for (unsigned t = 0; t < nslabs; ++t) {
+            publish(ready[t], std::numeric_limits<std::size_t>::max());
+            publish(consumed[t][0], std::numeric_limits<std::size_t>::max());
+            publish(consumed[t][1], std::numeric_limits<std::size_t>::max());
+        }
+    };
+
+    auto work = [&](unsigned t) {
+        slab& s = sl[t];
+        std::array<std::size_t, 3> m{s.planes(), n[1], n[2]};
+        std::size_t g0 = s.i0 - s.hlo; // global index of local plane 0
+
+        auto mtaps = detail::memory_taps(taps, m);
+        box_t reg{{std::max(s.i0, in.lo[0]) - g0, in.lo[1], in.lo[2]},
+                  {std::max(std::min(s.i1, in.hi[0]), std::max(s.i0, in.lo[0])) - g0, in.hi[1],
+                   in.hi[2]}};
+        bool active = reg.lo[0] < reg.hi[0] && reg.lo[1] < reg.hi[1] && reg.lo[2] < reg.hi[2];
+
+        publish(ready[t], 1); // state 0 is the current state of the slab
+        for (std::size_t k = 0; k < nsteps; ++k) {
+            unsigned b = (cur + k) % 2;
+            double* now = s.buf[b].data();
+            double* nxt = s.buf[1 - b].data();
+            // ghost planes of state k
+            if (s.hlo > 0) {
+                if (!wait_for(ready[t - 1], k + 1)) return;
+                slab const& nb = sl[t - 1];
+                double const* src = nb.buf[b].data() + (nb.hlo + nb.i1 - nb.i0 - s.hlo) * nplane;
+                std::copy(src, src + s.hlo * nplane, now);
+                count(consumed[t - 1][1]);
+            }
+            if (s.hhi > 0) {
+                if (!wait_for(ready[t + 1], k + 1)) return;
+                slab const& nb = sl[t + 1];
+                double const* src = nb.buf[b].data() + nb.hlo * nplane;
+                std::copy(src, src + s.hhi * nplane, now + (m[0] - s.hhi) * nplane);
+                count(consumed[t + 1][0]);
+            }
+            // nxt holds state k-1: wait until the neighbours have read it
+            if (k > 0) {
+                if (s.hlo > 0 && !wait_for(consumed[t][0], k)) return;
+                if (s.hhi > 0 && !wait_for(consumed[t][1], k)) return;
+            }
+
+            if (active) detail::euler_step_raw(now, nxt, m, mtaps, dt, reg);
+            publish(ready[t], k + 2);
+        }
+    };
+
+    for_slabs([&](unsigned t) {
+        try {
+            work(t);
+        }
+        catch (...) {
+            fail();
+            throw;
+        }
+    });
+    cur = (cur + nsteps) % 2;
+}
+
+inline void advance_slabs(field3d_t u, std::span<axis_stencil const> terms, double dt,
+                          std::size_t nsteps, unsigned nslabs)
+{
+    if (terms.empty()) {
+        throw std::invalid_argument("hd::advance_slabs(): no terms.");
+    }
+    if (nsteps == 0) return;
+
+    slab_field f({u.extent(0), u.extent(1), u.extent(2)}, terms_radius(terms)[0], nslabs);
+    f.scatter(u);
+    f.advance(terms, dt, nsteps);
+    f.gather(u);
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_SLAB_H
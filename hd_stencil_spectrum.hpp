@@ -0,0 +1,369 @@
+#ifndef HD_STENCIL_SPECTRUM_H
+#define HD_STENCIL_SPECTRUM_H
+
+// spectrum estimates of discrete operators and the largest stable explicit time step
+//
+// Estimates of the eigenvalues lambda of L in u' = L u:
+//
+//   gershgorin_box():     guaranteed bounds from the rows of the assembled operator
+//   power_iteration():    spectral radius max |lambda| of the assembled operator
+//   lanczos_box():        extreme eigenvalues of a symmetric assembled operator (ritz
+//                         values lie inside the spectrum, i.e. use a safety factor)
+//   von_neumann_symbol(): eigenvalues of the interior stencils on a periodic uniform grid
+//
+// The time step follows from the stability function R(z) of the integrator (value after
+// one step of u' = z u with u = 1, dt = 1): max_stable_dt() determines the largest dt with
+// |R(dt lambda)| <= 1 for all given lambda by bisection.
+//
+// Usage:
+//
+// std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+// auto lambda = hd::von_neumann_symbol(lap);
+// auto tab = hd::lsrk_carpenter_kennedy4();
+// double dt = hd::max_stable_dt([&](auto z) { return hd::stability_function(tab, z); }, lambda);
+//
+// hd::csr_matrix a = ...;                                         // operator incl. boundaries
+// auto box = hd::gershgorin_box(a);
+// double dt_a = hd::max_stable_dt(hd::ssprk3_stability, hd::box_boundary(box));
+
+#include "hd/hd_csr.hpp"          // hd::csr_matrix
+#include "hd/hd_stencil_apply.hpp" // hd::axis_stencil
+#include "hd/hd_stencil_lsrk.hpp"  // hd::lsrk_tableau
+
+#include <algorithm> // std::min(), std::max()
+#include <cmath>     // std::abs(), std::sqrt(), std::cos(), std::sin()
+#include <complex>
+#include <cstddef>
+#include <numbers>   // std::numbers::pi
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+// rectangle in the complex plane containing the eigenvalues (symmetric w.r.t. real axis)
+struct spectrum_box {
+    double re_min{0.0};
+    double re_max{0.0};
+    double im_max{0.0}; // |Im(lambda)| <= im_max
+};
+
+spectrum_box gershgorin_box(csr_matrix const& a);
+
+// estimate of max |lambda| (also for complex conjugate pairs of dominant eigenvalues)
+double power_iteration(csr_matrix const& a, int max_iter = 200, double tol = 1.0e-8);
+
+// min. and max. eigenvalue of a symmetric operator after m lanczos steps (im_max == 0)
+spectrum_box lanczos_box(csr_matrix const& a, int m = 40);
+
+// symbol sum_terms sum_j w_j exp(i o_j theta_axis) for ntheta angles in [-pi, pi) per axis
+std::vector<std::complex<double>> von_neumann_symbol(std::span<axis_stencil const> terms,
+                                                     int ntheta = 32);
+
+spectrum_box bounding_box(std::span<std::complex<double> const> lambda);
+
+// n points on each side of the box (the real segment if im_max == 0)
+std::vector<std::complex<double>> box_boundary(spectrum_box const& b, int n = 64);
+
+// stability functions R(z)
+std::complex<double> stability_function(lsrk_tableau const& tab, std::complex<double> z);
+std::complex<double> ssprk2_stability(std::complex<double> z);
+std::complex<double> ssprk3_stability(std::complex<double> z);
+
+// largest dt with |R(dt lambda)| <= 1 + 1e-12 for all lambda (0 if no dt > 0 is stable)
+template <class R>
+double max_stable_dt(R const& stab, std::span<std::complex<double> const> lambda,
+                     double rtol = 1.0e-8);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline spectrum_box gershgorin_box(csr_matrix const& a)
+{
+    if (a.nrows != a.ncols || a.nrows == 0) {
+        throw std::invalid_argument("hd::gershgorin_box(): matrix not square or empty.");
+    }
+    spectrum_box b{1.0e300, -1.0e300, 0.0};
+    for (std::size_t i = 0; i < a.nrows; ++i) {
+        double c = 0.0, r = 0.0;
+        for (std::size_t p = a.row_ptr[i]; p < a.row_ptr[i + 1]; ++p) {
+            if (a.col[p] == i)
+                c += a.val[p];
+            else
+                r += std::abs(a.val[p]);
+        }
+        b.re_min = std::min(b.re_min, c - r);
+        b.re_max = std::max(b.re_max, c + r);
+        b.im_max = std::max(b.im_max, r);
+    }
+    return b;
+}
+
+//******************************************************************************
+// two products per iteration: sqrt(|A^2 x| / |x|) converges for a dominant pair +-lambda
+// or lambda, conj(lambda) as well
+//******************************************************************************
+inline double power_iteration(csr_matrix const& a, int max_iter, double tol)
+{
+    if (a.nrows != a.ncols || a.nrows == 0) {
+        throw std::invalid_argument("hd::power_iteration(): matrix not square or empty.");
+    }
+    std::size_t n = a.nrows;
+    auto norm = [](std::vector<double> const& v) {
+        double s = 0.0;
+        for (double x : v)
+            s += x * x;
+        return std::sqrt(s);
+    };
+
+    // deterministic start vector with components in all directions
+    std::vector<double> x(n), y(n), z(n);
+    for (std::size_t i = 0; i < n; ++i)
+        x[i] = 1.0 + 0.5 * std::sin(1.0 + 7.0 * i);
+    double nx = norm(x);
+    for (double& v : x)
+        v /= nx;
+
+    double rho = 0.0;
+    for (int it = 0; it < max_iter; ++it) {
+        a.multiply(x, y);
+        a.multiply(y, z);
+        double nz = norm(z);
+        if (nz == 0.0) return 0.0; // nilpotent on start vector
+        double rho_new = std::sqrt(nz);
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = z[i] / nz;
+        if (std::abs(rho_new - rho) <= tol * rho_new) return rho_new;
+        rho = rho_new;
+    }
+    return rho;
+}
+
+namespace detail {
+
+// number of eigenvalues < s of the symmetric tridiagonal matrix (alpha, beta) (sturm sequence)
+inline int sturm_count(std::vector<double> const& alpha, std::vector<double> const& beta, double s)
+{
+    int cnt = 0;
+    double q = 1.0;
+    for (std::size_t i = 0; i < alpha.size(); ++i) {
+        double b2 = (i > 0) ? beta[i - 1] * beta[i - 1] : 0.0;
+        q = alpha[i] - s - ((i > 0) ? b2 / q : 0.0);
+        if (q == 0.0) q = 1.0e-300;
+        if (q < 0.0) ++cnt;
+    }
+    return cnt;
+}
+
+// k-th smallest eigenvalue (k = 0 ... n-1) of a symmetric tridiagonal matrix by bisection
+inline double tridiag_eigenvalue(std::vector<double> const& alpha, std::vector<double> const& beta,
+                                 int k)
+{
+    double lo = 0.0, hi = 0.0;
+    for (std::size_t i = 0; i < alpha.size(); ++i) {
+        double r = ((i > 0) ? std::abs(beta[i - 1]) : 0.0) +
+                   ((i < beta.size()) ? std::abs(beta[i]) : 0.0);
+        lo = std::min(lo, alpha[i] - r);
+        hi = std::max(hi, alpha[i] + r);
+    }
+    for (int it = 0; it < 200 && hi - lo > 1.0e-15 * std::max(std::abs(lo), std::abs(hi)); ++it) {
+        double mid = 0.5 * (lo + hi);
+        if (sturm_count(alpha, beta, mid) > k)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+} // namespace detail
+
+//******************************************************************************
+// lanczos with full reorthogonalization (m is small compared to the operator size)
+//******************************************************************************
+inline spectrum_box lanczos_box(csr_matrix const& a, int m)
+{
+    if (a.nrows != a.ncols || a.nrows == 0 || m < 1) {
+        throw std::invalid_argument("hd::lanczos_box(): matrix not square or empty, or m < 1.");
+    }
+    std::size_t n = a.nrows;
+    m = std::min<std::size_t>(m, n);
+
+    std::vector<double> q(n * m), w(n), alpha, beta;
+    double nq = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        q[i] = 1.0 + 0.5 * std::sin(1.0 + 7.0 * i);
+        nq += q[i] * q[i];
+    }
+    nq = std::sqrt(nq);
+    for (std::size_t i = 0; i < n; ++i)
+        q[i] /= nq;
+
+    for (int k = 0; k < m; ++k) {
+        double const* qk = q.data() + k * n;
+        a.multiply({qk, n}, w);
+        // orthogonalize against all previous vectors (twice for stability)
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int j = 0; j <= k; ++j) {
+                double const* qj = q.data() + j * n;
+                double d = 0.0;
+                for (std::size_t i = 0; i < n; ++i)
+                    d += qj[i] * w[i];
+                if (pass == 0 && j == k) alpha.push_back(d);
+                for (std::size_t i = 0; i < n; ++i)
+                    w[i] -= d * qj[i];
+            }
+        }
+        double b = 0.0;
+        for (double v : w)
+            b += v * v;
+        b = std::sqrt(b);
+        if (k + 1 == m || b <= 1.0e-12 * std::abs(alpha.back())) break; // invariant subspace
+        beta.push_back(b);
+        double* qn = q.data() + (k + 1) * n;
+        for (std::size_t i = 0; i < n; ++i)
+            qn[i] = w[i] / b;
+    }
+    return {detail::tridiag_eigenvalue(alpha, beta, 0),
+            detail::tridiag_eigenvalue(alpha, beta, alpha.size() - 1), 0.0};
+}
+
+//******************************************************************************
+// the symbols of the axes add up; all combinations of the angles of the used axes
+//******************************************************************************
+inline std::vector<std::complex<double>> von_neumann_symbol(std::span<axis_stencil const> terms,
+                                                            int ntheta)
+{
+    if (terms.empty() || ntheta < 2) {
+        throw std::invalid_argument("hd::von_neumann_symbol(): no terms or ntheta < 2.");
+    }
+    // symbol of each axis at the angles theta_k = -pi + 2 pi k / ntheta
+    std::vector<std::vector<std::complex<double>>> sym(3);
+    for (auto const& t : terms) {
+        if (t.axis > 2) {
+            throw std::invalid_argument("hd::von_neumann_symbol(): invalid axis.");
+        }
+        auto& s = sym[t.axis];
+        s.resize(ntheta, 0.0);
+        for (int k = 0; k < ntheta; ++k) {
+            double theta = std::numbers::pi * (-1.0 + 2.0 * k / ntheta);
+            for (int j = 0; j < t.w.size(); ++j)
+                s[k] += t.w.weight[j] * std::polar(1.0, t.w.offset[j] * theta);
+        }
+    }
+    std::vector<std::complex<double>> lambda{0.0};
+    for (auto const& s : sym) {
+        if (s.empty()) continue;
+        std::vector<std::complex<double>> next;
+        next.reserve(lambda.size() * s.size());
+        for (auto l : lambda)
+            for (auto v : s)
+                next.push_back(l + v);
+        lambda.swap(next);
+    }
+    return lambda;
+}
+
+inline spectrum_box bounding_box(std::span<std::complex<double> const> lambda)
+{
+    if (lambda.empty()) {
+        throw std::invalid_argument("hd::bounding_box(): no eigenvalues.");
+    }
+    spectrum_box b{lambda[0].real(), lambda[0].real(), 0.0};
+    for (auto l : lambda) {
+        b.re_min = std::min(b.re_min, l.real());
+        b.re_max = std::max(b.re_max, l.real());
+        b.im_max = std::max(b.im_max, std::abs(l.imag()));
+    }
+    return b;
+}
+
+inline std::vector<std::complex<double>> box_boundary(spectrum_box const& b, int n)
+{
+    std::vector<std::complex<double>> z;
+    for (int k = 0; k <= n; ++k) {
+        double s = double(k) / n;
+        double re = b.re_min + s * (b.re_max - b.re_min);
+        z.emplace_back(re, b.im_max);
+        if (b.im_max > 0.0) {
+            z.emplace_back(re, -b.im_max);
+            double im = -b.im_max + 2.0 * s * b.im_max;
+            z.emplace_back(b.re_min, im);
+            z.emplace_back(b.re_max, im);
+        }
+    }
+    return z;
+}
+
+//******************************************************************************
+// one step of the 2N scheme applied to u' = z u with u = 1, dt = 1
+//******************************************************************************
+inline std::complex<double> stability_function(lsrk_tableau const& tab, std::complex<double> z)
+{
+    std::complex<double> u = 1.0, du = 0.0;
+    for (int k = 0; k < tab.stages(); ++k) {
+        du = tab.a[k] * du + z * u;
+        u += tab.b[k] * du;
+    }
+    return u;
+}
+
+inline std::complex<double> ssprk2_stability(std::complex<double> z)
+{
+    return 1.0 + z * (1.0 + 0.5 * z);
+}
+
+inline std::complex<double> ssprk3_stability(std::complex<double> z)
+{
+    return 1.0 + z * (1.0 + z * (0.5 + z / 6.0));
+}
+
+//******************************************************************************
+// bracket by halving/doubling of dt = 1/max|lambda|, then bisection (assumes the set of
+// stable dt is an interval [0, dt_max], true for the usual stability regions)
+//******************************************************************************
+template <class R>
+double max_stable_dt(R const& stab, std::span<std::complex<double> const> lambda, double rtol)
+{
+    double lmax = 0.0;
+    for (auto l : lambda)
+        lmax = std::max(lmax, std::abs(l));
+    if (lmax == 0.0) {
+        throw std::invalid_argument("hd::max_stable_dt(): no nonzero eigenvalue.");
+    }
+    auto stable = [&](double dt) {
+        for (auto l : lambda)
+            if (std::abs(stab(dt * l)) > 1.0 + 1.0e-12) return false;
+        return true;
+    };
+
+    double lo = 1.0 / lmax, hi = lo;
+    if (stable(lo)) {
+        do {
+            lo = hi;
+            hi *= 2.0;
+            if (hi * lmax > 1.0e6) return lo; // stable for (practically) all dt
+        } while (stable(hi));
+    }
+    else {
+        int k = 0;
+        do {
+            hi = lo;
+            lo *= 0.5;
+            if (++k == 60) return 0.0;
+        } while (!stable(lo));
+    }
+    while (hi - lo > rtol * lo) {
+        double mid = 0.5 * (lo + hi);
+        if (stable(mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_SPECTRUM_H
@@ -0,0 +1,250 @@
+#ifndef HD_STENCIL_STREAM_H
+#define HD_STENCIL_STREAM_H
+
+// out-of-core application of stencils to 3D fields stored in files (POSIX mmap)
+//
+// The files contain the raw values (double) of a row major field with extents n.
+// The field is processed in slabs of planes along axis 0. Each slab is read with a halo
+// of the stencil radius in axis 0. While a slab is computed, the pages of the next slab
+// are faulted in asynchronously; consumed pages are released again, i.e. the resident
+// memory is limited to a few slabs independent of the size of the field.
+//
+// Usage:
+//
+// std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+// hd::stream_apply("u.bin", "lap_u.bin", {n0, n1, n2}, lap, 32);
+//
+// As with hd::apply_fused() only points with full stencil support are written, all other
+// points of the output file are zero.
+
+#include "hd/hd_stencil_apply.hpp" // hd::apply_fused()
+
+#include <fcntl.h>    // open()
+#include <sys/mman.h> // mmap(), munmap(), madvise(), msync()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close(), ftruncate(), sysconf()
+
+#include <algorithm> // std::min()
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint> // std::uintptr_t
+#include <cstring> // std::strerror()
+#include <future>  // std::async()
+#include <span>
+#include <stdexcept> // std::runtime_error, std::invalid_argument
+#include <string>
+#include <utility> // std::exchange()
+#include <vector>
+
+namespace hd {
+
+enum class map_mode {
+    read,  // map existing file read only
+    create // create (or truncate) file with given size, map read/write
+};
+
+// memory mapped file of double values
+class mapped_file {
+  public:
+    // count: number of values of the file (create) or min. number of values (read)
+    mapped_file(std::string const& path, map_mode mode, std::size_t count = 0);
+    ~mapped_file();
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+
+    double* data() const { return ptr; }
+    std::size_t size() const { return cnt; } // number of values
+
+    // hints to the kernel for the values [first, first + count)
+    void will_need(std::size_t first, std::size_t count) const;
+    void dont_need(std::size_t first, std::size_t count) const;
+    void sync(std::size_t first, std::size_t count) const; // async write back
+
+  private:
+    double* ptr{nullptr};
+    std::size_t cnt{0};
+    map_mode mode{map_mode::read};
+
+    void advise(std::size_t first, std::size_t count, int advice) const;
+};
+
+void stream_apply(std::string const& in_path, std::string const& out_path,
+                  std::array<std::size_t, 3> n, std::span<axis_stencil const> terms,
+                  std::size_t slab = 16);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline mapped_file::mapped_file(std::string const& path, map_mode mode, std::size_t count) :
+    mode{mode}
+{
+    auto fail = [&path](char const* what) {
+        throw std::runtime_error("hd::mapped_file: " + std::string(what) + " '" + path +
+                                 "': " + std::strerror(errno));
+    };
+
+    int fd = (mode == map_mode::read) ? ::open(path.c_str(), O_RDONLY)
+                                      : ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) fail("cannot open");
+
+    if (mode == map_mode::read) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            fail("cannot stat");
+        }
+        if (static_cast<std::size_t>(st.st_size) < count * sizeof(double)) {
+            ::close(fd);
+            throw std::runtime_error("hd::mapped_file: file '" + path + "' too short.");
+        }
+        count = st.st_size / sizeof(double);
+    }
+    else if (::ftruncate(fd, count * sizeof(double)) != 0) {
+        ::close(fd);
+        fail("cannot resize");
+    }
+    cnt = count;
+
+    if (cnt > 0) {
+        int prot = (mode == map_mode::read) ? PROT_READ : PROT_READ | PROT_WRITE;
+        void* p = ::mmap(nullptr, cnt * sizeof(double), prot, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            fail("cannot map");
+        }
+        ptr = static_cast<double*>(p);
+    }
+    ::close(fd); // mapping stays valid
+}
+
+inline mapped_file::~mapped_file()
+{
+    if (ptr) ::munmap(ptr, cnt * sizeof(double));
+}
+
+inline mapped_file::mapped_file(mapped_file&& other) noexcept :
+    ptr{std::exchange(other.ptr, nullptr)}, cnt{std::exchange(other.cnt, 0)}, mode{other.mode}
+{
+}
+
+inline mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other) {
+        if (ptr) ::munmap(ptr, cnt * sizeof(double));
+        ptr = std::exchange(other.ptr, nullptr);
+        cnt = std::exchange(other.cnt, 0);
+        mode = other.mode;
+    }
+    return *this;
+}
+
+inline void mapped_file::advise(std::size_t first, std::size_t count, int advice) const
+{
+    if (!ptr || count == 0 || first >= cnt) return;
+    count = std::min(count, cnt - first);
+
+    // madvise() requires page aligned addresses
+    static const std::size_t page = ::sysconf(_SC_PAGESIZE);
+    auto b = reinterpret_cast<std::uintptr_t>(ptr + first) / page * page;
+    auto e = reinterpret_cast<std::uintptr_t>(ptr + first + count);
+    ::madvise(reinterpret_cast<void*>(b), e - b, advice); // hint only, errors are ignored
+}
+
+inline void mapped_file::will_need(std::size_t first, std::size_t count) const
+{
+    advise(first, count, MADV_WILLNEED);
+}
+
+inline void mapped_file::dont_need(std::size_t first, std::size_t count) const
+{
+    advise(first, count, MADV_DONTNEED);
+}
+
+inline void mapped_file::sync(std::size_t first, std::size_t count) const
+{
+    if (!ptr || mode == map_mode::read || count == 0 || first >= cnt) return;
+    count = std::min(count, cnt - first);
+
+    static const std::size_t page = ::sysconf(_SC_PAGESIZE);
+    auto b = reinterpret_cast<std::uintptr_t>(ptr + first) / page * page;
+    auto e = reinterpret_cast<std::uintptr_t>(ptr + first + count);
+    ::msync(reinterpret_cast<void*>(b), e - b, MS_ASYNC);
+}
+
+//******************************************************************************
+// apply the sum of stencils terms to the field in in_path and write it to out_path
+//
+// slab: number of planes (axis 0) computed per step
+//******************************************************************************
+inline void stream_apply(std::string const& in_path, std::string const& out_path,
+                         std::array<std::size_t, 3> n, std::span<axis_stencil const> terms,
+                         std::size_t slab)
+{
+    if (slab == 0 || terms.empty()) {
+        throw std::invalid_argument("hd::stream_apply(): slab == 0 or no terms.");
+    }
+    std::size_t plane = n[1] * n[2];
+
+    mapped_file in(in_path, map_mode::read);
+    if (in.size() != n[0] * plane) {
+        throw std::invalid_argument("hd::stream_apply(): size of input file does not match extents.");
+    }
+    mapped_file out(out_path, map_mode::create, n[0] * plane);
+
+    std::size_t r0 = terms_radius(terms)[0];
+    std::vector<axis_stencil> tv(terms.begin(), terms.end());
+
+    // planes of input needed for the slab starting at plane s
+    auto first_plane = [&](std::size_t s) { return s > r0 ? s - r0 : 0; };
+    auto last_plane = [&](std::size_t s) { return std::min(n[0], s + slab + r0); };
+
+    // fault in pages of a plane range (executed concurrently to the computation)
+    auto prefetch = [&in, plane](std::size_t p0, std::size_t p1) {
+        in.will_need(p0 * plane, (p1 - p0) * plane);
+        static const std::size_t step = ::sysconf(_SC_PAGESIZE) / sizeof(double);
+        double volatile sum = 0.0;
+        double const* p = in.data();
+        for (std::size_t i = p0 * plane; i < p1 * plane; i += step)
+            sum = sum + p[i];
+    };
+
+    std::future<void> next;
+    if (n[0] > 0) prefetch(first_plane(0), last_plane(0));
+
+    for (std::size_t s = 0; s < n[0]; s += slab) {
+        std::size_t p0 = first_plane(s), p1 = last_plane(s);
+
+        if (s + slab < n[0]) {
+            // prefetch the planes of the next slab not yet covered by the current one
+            std::size_t q0 = std::max(p1, first_plane(s + slab)), q1 = last_plane(s + slab);
+            if (q0 < q1) next = std::async(std::launch::async, prefetch, q0, q1);
+        }
+
+        // the slab incl. halo as field of its own: apply_fused() then writes exactly the
+        // planes [s, s + slab) (as far as they have full stencil support)
+        std::size_t m = p1 - p0;
+        cfield3d_t fin{in.data() + p0 * plane, m, n[1], n[2]};
+        fused_output fo{field3d_t{out.data() + p0 * plane, m, n[1], n[2]}, tv};
+        apply_fused(fin, std::span<fused_output const>(&fo, 1));
+
+        // release planes that are not needed anymore
+        std::size_t s_end = std::min(n[0], s + slab);
+        out.sync(s * plane, (s_end - s) * plane);
+        out.dont_need(s * plane, (s_end - s) * plane); // written back by the kernel
+        if (s_end < n[0]) {
+            std::size_t keep = first_plane(s_end);
+            if (keep > p0) in.dont_need(p0 * plane, (keep - p0) * plane);
+        }
+
+        if (next.valid()) next.get();
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_STREAM_H
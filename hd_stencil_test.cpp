@@ -0,0 +1,1195 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+// include functions to be tests
+#include "hd_stencil_amr.hpp"
+#include "hd_stencil_apply.hpp"
+#include "hd_stencil_autotune.hpp"
+#include "hd_stencil_compact.hpp"
+#include "hd_stencil_convergence.hpp"
+#include "hd_stencil_csr.hpp"
+#include "hd_stencil_field.hpp"
+#include "hd_stencil_filter.hpp"
+#include "hd_stencil_lsrk.hpp"
+#include "hd_stencil_metric.hpp"
+#include "hd_stencil_mixed.hpp"
+#include "hd_stencil_moving.hpp"
+#include "hd_stencil_richardson.hpp"
+#include "hd_stencil_shm.hpp"
+#include "hd_stencil_slab.hpp"
+#include "hd_stencil_spectrum.hpp"
+#include "hd_stencil_stream.hpp"
+#include "hd_stencil_timeblock.hpp"
+#include "hd_stencil_transfer.hpp"
+
+#include "hd_quadrature.hpp"
+#include "hd_rbf_fd.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <complex>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("multi_deriv_weights():")
+{
+    TEST_CASE("multi_deriv_weights(): same weights as stencil_t for f' and f''")
+    {
+        std::vector<double> xf0{-0.2, -0.1, 0.0, 0.15, 0.3};
+        double x0 = 0.05;
+
+        auto w = hd::multi_deriv_weights(x0, xf0, {1, 2});
+        hd::stencil_t s1(x0, hd::stencil_lhs::f1, xf0, {x0}, {});
+        hd::stencil_t s2(x0, hd::stencil_lhs::f2, xf0, {}, {x0});
+
+        REQUIRE(w.size() == 2);
+        for (std::size_t j = 0; j < xf0.size(); ++j) {
+            CHECK(w[0][j] == doctest::Approx(s1.wf0[j]).epsilon(1.0e-10));
+            CHECK(w[1][j] == doctest::Approx(s2.wf0[j]).epsilon(1.0e-10));
+        }
+    }
+}
+
+TEST_SUITE("stencil_t order:")
+{
+    TEST_CASE("stencil_t: order and truncation error independent of spacing")
+    {
+        for (double h : {1.0, 1.0e-3}) {
+            hd::stencil_t c1(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {});
+            CHECK(c1.order() == 2);
+            CHECK(c1.trunc_err() == doctest::Approx(h * h / 6.0));
+
+            hd::stencil_t c2(0.0, hd::stencil_lhs::f2, {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0});
+            CHECK(c2.order() == 4);
+
+            // pade scheme: tridiagonal lhs, 5 point rhs
+            hd::stencil_t p1(0.0, hd::stencil_lhs::f1, {-2 * h, -h, 0.0, h, 2 * h},
+                             {-h, 0.0, h}, {});
+            CHECK(p1.order() == 6);
+        }
+
+        // table check
+        std::vector<double> xf0{-0.2, -0.1, 0.0, 0.1, 0.2};
+        std::vector<hd::stencil_fixed_t> table;
+        for (double x0 : {-0.2, 0.0, 0.1}) {
+            double xf1[1] = {x0};
+            table.emplace_back(x0, hd::stencil_lhs::f1, xf0, xf1, std::span<double const>{});
+        }
+        auto rep = hd::verify_stencil_table(table, 4);
+        CHECK(rep.nstencils == 3);
+        CHECK(rep.min_order == 4);
+        CHECK(rep.max_order == 4);
+        CHECK(rep.failed.empty());
+        CHECK(hd::verify_stencil_table(table, 5).failed.size() == 3);
+    }
+}
+
+TEST_SUITE("stencil_t double-double:")
+{
+    TEST_CASE("stencil_t: double-double weights of a 21 point central f' stencil")
+    {
+        // exact weights: w_k = (-1)^(k+1) (m!)^2 / (k (m-k)! (m+k)!), k = -m ... m, k != 0
+        const int m = 10;
+        std::vector<double> xf0;
+        for (int k = -m; k <= m; ++k)
+            xf0.push_back(k);
+
+        hd::stencil_t s(0.0, hd::stencil_lhs::f1, xf0, {0.0}, {},
+                        hd::stencil_precision::double_double);
+        hd::stencil_t sd(0.0, hd::stencil_lhs::f1, xf0, {0.0}, {});
+
+        double err = 0.0, err_d = 0.0; // max. absolute errors of the weights
+        for (int k = -m; k <= m; ++k) {
+            double w = 0.0;
+            if (k != 0) {
+                w = (k % 2 == 0) ? -1.0 : 1.0;
+                for (int j = 1; j <= m; ++j)
+                    w *= double(j) * j;
+                for (int j = 1; j <= m - k; ++j)
+                    w /= j;
+                for (int j = 1; j <= m + k; ++j)
+                    w /= j;
+                w /= k;
+            }
+            CHECK(s.wf0[k + m] == doctest::Approx(w).epsilon(1.0e-15));
+            err = std::max(err, std::abs(s.wf0[k + m] - w));
+            err_d = std::max(err_d, std::abs(sd.wf0[k + m] - w));
+        }
+        // ill-conditioned moment system: double precision weights clearly less accurate
+        CHECK(err_d > 1.0e3 * err);
+        CHECK(err_d > 1.0e-10);
+    }
+}
+
+TEST_SUITE("stencil_fixed_t:")
+{
+    TEST_CASE("stencil_fixed_t: same weights as stencil_t, storable in a vector")
+    {
+        std::vector<double> xf0{-0.2, -0.1, 0.0, 0.1, 0.2}, xf1{-0.1, 0.0, 0.1};
+        hd::stencil_t s(0.0, hd::stencil_lhs::f1, xf0, xf1, {});
+
+        std::vector<hd::stencil_fixed_t> v;
+        v.emplace_back(0.0, hd::stencil_lhs::f1, xf0, xf1, std::span<double const>{});
+        v.push_back(v[0]);
+        v[0] = hd::stencil_fixed_t{};
+
+        hd::stencil_fixed_t const& f = v[1];
+        REQUIRE(f.n() == s.n());
+        CHECK(v[0].n() == 0);
+        for (int j = 0; j < s.nf0(); ++j)
+            CHECK(f.wf0()[j] == doctest::Approx(s.wf0[j]).epsilon(1.0e-12));
+        for (int j = 0; j < s.nf1(); ++j)
+            CHECK(f.wf1()[j] == doctest::Approx(s.wf1[j]).epsilon(1.0e-12));
+    }
+}
+
+TEST_SUITE("make_transfer():")
+{
+    TEST_CASE("make_transfer(): cubic interpolation exact for cubic polynomials")
+    {
+        std::vector<double> xs, xt, fs, ft(25);
+        for (int i = 0; i < 9; ++i)
+            xs.push_back(0.125 * i + 0.01 * i * i);
+        for (int i = 0; i < 25; ++i)
+            xt.push_back(1.64 / 24 * i);
+        for (double x : xs)
+            fs.push_back(x * x * x - 2.0 * x + 1.0);
+
+        auto tr = hd::make_transfer(xs, xt, 4, 2);
+        tr.apply(fs, ft);
+
+        for (std::size_t i = 0; i < xt.size(); ++i) {
+            double x = xt[i];
+            CHECK(ft[i] == doctest::Approx(x * x * x - 2.0 * x + 1.0).epsilon(1.0e-10));
+        }
+
+        // target points outside the source grid: extrapolated, exact for cubics
+        std::vector<double> xo{-0.2, -0.05, 1.7, 1.9}, fo(4);
+        hd::make_transfer(xs, xo, 4).apply(fs, fo);
+        for (std::size_t i = 0; i < xo.size(); ++i) {
+            double x = xo[i];
+            CHECK(fo[i] == doctest::Approx(x * x * x - 2.0 * x + 1.0).epsilon(1.0e-10));
+        }
+
+        // duplicate source point: singular moment system
+        std::vector<double> xd = xs;
+        xd[4] = xd[3];
+        CHECK_THROWS(hd::make_transfer(xd, xt, 4, 2));
+    }
+}
+
+TEST_SUITE("quadrature_weights():")
+{
+    TEST_CASE("quadrature_weights(): exact for polynomials on a nonuniform grid")
+    {
+        std::vector<double> x, f2, f4;
+        for (int i = 0; i < 11; ++i)
+            x.push_back(0.1 * i + 0.02 * i * i);
+        for (double xi : x) {
+            f2.push_back(3.0 * xi + 1.0);
+            f4.push_back(xi * xi * xi - xi);
+        }
+        double b = x.back();
+
+        // trapezoidal rule for np == 2
+        auto w2 = hd::quadrature_weights(x, 2);
+        CHECK(hd::integrate(w2, f2) == doctest::Approx(1.5 * b * b + b).epsilon(1.0e-12));
+        CHECK(w2[0] == doctest::Approx(0.5 * (x[1] - x[0])));
+
+        auto w4 = hd::quadrature_weights(x, 4);
+        CHECK(hd::integrate(w4, f4) == doctest::Approx(0.25 * b * b * b * b - 0.5 * b * b).epsilon(1.0e-12));
+    }
+}
+
+TEST_SUITE("apply_fused():")
+{
+    TEST_CASE("apply_fused(): f', f'' and laplacian of a polynomial in one sweep")
+    {
+        const std::size_t n = 8;
+        const double h = 0.5;
+
+        std::vector<double> mem_f(n * n * n), mem_fx(n * n * n, 0.0), mem_fxx(n * n * n, 0.0),
+            mem_lap(n * n * n, 0.0);
+        hd::field3d_t f{mem_f.data(), n, n, n};
+        hd::field3d_t fx{mem_fx.data(), n, n, n};
+        hd::field3d_t fxx{mem_fxx.data(), n, n, n};
+        hd::field3d_t lap{mem_lap.data(), n, n, n};
+
+        // f = x^2 + y^2 + z^2 + x*y*z (exact for 3-point stencils)
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                for (std::size_t k = 0; k < n; ++k) {
+                    double x = i * h, y = j * h, z = k * h;
+                    f[i, j, k] = x * x + y * y + z * z + x * y * z;
+                }
+
+        hd::stencil_weights d1{hd::stencil_t(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {}), h};
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2, {-h, 0.0, h}, {}, {0.0}), h};
+        CHECK(d1.radius() == 1);
+        CHECK(d2.size() == 3);
+
+        std::vector<hd::fused_output> out{{fx, {{0, d1}}},
+                                          {fxx, {{0, d2}}},
+                                          {lap, {{0, d2}, {1, d2}, {2, d2}}}};
+        hd::apply_fused(f, out);
+
+        for (std::size_t i = 1; i < n - 1; ++i)
+            for (std::size_t j = 1; j < n - 1; ++j)
+                for (std::size_t k = 1; k < n - 1; ++k) {
+                    double x = i * h, y = j * h, z = k * h;
+                    CHECK(fx[i, j, k] == doctest::Approx(2.0 * x + y * z));
+                    CHECK(fxx[i, j, k] == doctest::Approx(2.0));
+                    CHECK(lap[i, j, k] == doctest::Approx(6.0));
+                }
+        // boundary points are left untouched
+        CHECK(lap[0, 3, 3] == 0.0);
+    }
+    TEST_CASE("apply_fused(): throws on stencils that are not explicit")
+    {
+        CHECK_THROWS(hd::stencil_weights(hd::stencil_t(0.0, hd::stencil_lhs::f1, {-1.0, 0.0, 1.0}, {-1.0, 0.0, 1.0}, {}), 1.0));
+    }
+}
+
+TEST_SUITE("advance_blocked():")
+{
+    TEST_CASE("advance_blocked(): same result as unblocked time steps")
+    {
+        const std::size_t n0 = 23, n1 = 19, n2 = 17;
+        const double h = 0.1;
+
+        std::vector<double> mem_a(n0 * n1 * n2), mem_b(n0 * n1 * n2), mem_w(n0 * n1 * n2);
+        for (std::size_t i = 0; i < mem_a.size(); ++i)
+            mem_a[i] = std::sin(0.37 * i);
+        mem_b = mem_a;
+        std::vector<double> mem_c = mem_a, mem_0 = mem_a;
+        hd::field3d_t ua{mem_a.data(), n0, n1, n2};
+        hd::field3d_t ub{mem_b.data(), n0, n1, n2};
+        hd::field3d_t uc{mem_c.data(), n0, n1, n2};
+        hd::field3d_t work{mem_w.data(), n0, n1, n2};
+
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2,
+                                             {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}),
+                               h};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+
+        hd::advance(ua, work, lap, 1.0e-4, 11);
+        hd::advance_blocked(ub, work, lap, 1.0e-4, 11, {3, 5, 7});
+        hd::advance_blocked(uc, work, lap, 1.0e-4, 11, {3, 5, 7, 4}); // 4 threads
+
+        for (std::size_t i = 0; i < mem_a.size(); ++i) {
+            CHECK(mem_a[i] == mem_b[i]);
+            CHECK(mem_a[i] == mem_c[i]);
+        }
+
+        // tiling in axis 2 (tile2 = 6) and complete rows (tile2 = 0)
+        for (std::size_t t2 : {6, 0}) {
+            std::vector<double> mem_d(mem_0);
+            hd::field3d_t ud{mem_d.data(), n0, n1, n2};
+            hd::advance_blocked(ud, work, lap, 1.0e-4, 11, {4, 6, 5, 2, t2});
+            CHECK(mem_d == mem_a);
+        }
+    }
+}
+
+TEST_SUITE("compact_derivative:")
+{
+    TEST_CASE("compact_derivative: exact for polynomials along any axis")
+    {
+        const std::size_t n0 = 3, n1 = 20, n2 = 5;
+        const double h = 0.1;
+
+        std::vector<double> mem_f(n0 * n1 * n2), mem_df(n0 * n1 * n2), mem_d2f(n0 * n1 * n2);
+        hd::field3d_t f{mem_f.data(), n0, n1, n2};
+        hd::field3d_t df{mem_df.data(), n0, n1, n2};
+        hd::field3d_t d2f{mem_d2f.data(), n0, n1, n2};
+
+        // f = y^3 + x*z (derivatives along axis 1)
+        for (std::size_t i = 0; i < n0; ++i)
+            for (std::size_t j = 0; j < n1; ++j)
+                for (std::size_t k = 0; k < n2; ++k) {
+                    double x = i * h, y = j * h, z = k * h;
+                    f[i, j, k] = y * y * y + x * z;
+                }
+
+        hd::compact_derivative d1(n1, h);
+        hd::compact_derivative d2(n1, h, 1, 2, hd::stencil_lhs::f2);
+        d1.apply(f, df, 1);
+        d2.apply(f, d2f, 1);
+
+        for (std::size_t i = 0; i < n0; ++i)
+            for (std::size_t j = 0; j < n1; ++j)
+                for (std::size_t k = 0; k < n2; ++k) {
+                    double y = j * h;
+                    CHECK(df[i, j, k] == doctest::Approx(3.0 * y * y).epsilon(1.0e-8));
+                    CHECK(d2f[i, j, k] == doctest::Approx(6.0 * y).epsilon(1.0e-8));
+                }
+    }
+}
+
+TEST_SUITE("metric_derivative:")
+{
+    TEST_CASE("metric_derivative: exact for polynomials on a stretched grid")
+    {
+        const std::size_t n = 12, m = 3;
+
+        // x = xi + 0.05*xi^2, f = x^2 (polynomial of degree 4 in xi)
+        std::vector<double> x(n);
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = i + 0.05 * i * i;
+
+        hd::metric_derivative<5> d(x);
+
+        std::vector<double> mem_f(n * m * n), mem_df(n * m * n), mem_d2f(n * m * n);
+        hd::field3d_t f{mem_f.data(), n, m, n};
+        hd::field3d_t df{mem_df.data(), n, m, n};
+        hd::field3d_t d2f{mem_d2f.data(), n, m, n};
+
+        for (std::size_t axis : {0, 2}) {
+            for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t j = 0; j < m; ++j)
+                    for (std::size_t k = 0; k < n; ++k) {
+                        double xa = x[axis == 0 ? i : k];
+                        f[i, j, k] = xa * xa;
+                    }
+
+            d.d1(f, df, axis);
+            d.d2(f, d2f, axis);
+
+            for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t j = 0; j < m; ++j)
+                    for (std::size_t k = 0; k < n; ++k) {
+                        double xa = x[axis == 0 ? i : k];
+                        CHECK(df[i, j, k] == doctest::Approx(2.0 * xa).epsilon(1.0e-8));
+                        CHECK(d2f[i, j, k] == doctest::Approx(2.0).epsilon(1.0e-8));
+                    }
+        }
+
+        // decreasing grid accepted, grid reversing direction (x_xi = 11 - 2 xi) rejected
+        std::vector<double> xd(n), xr(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            xd[i] = -x[i];
+            xr[i] = double(i) * (n - 1.0 - i);
+        }
+        CHECK_NOTHROW(hd::metric_derivative<5>(xd));
+        CHECK_THROWS(hd::metric_derivative<5>(xr));
+    }
+}
+
+TEST_SUITE("rbf_fd_operators():")
+{
+    TEST_CASE("rbf_fd_operators(): exact for quadratic polynomials on scattered points")
+    {
+        // jittered 12 x 12 grid
+        std::vector<std::array<double, 2>> pts;
+        for (int i = 0; i < 12; ++i)
+            for (int j = 0; j < 12; ++j)
+                pts.push_back({0.1 * i + 0.03 * std::sin(7.0 * i + 3.0 * j),
+                               0.1 * j + 0.03 * std::cos(5.0 * i - 2.0 * j)});
+
+        std::vector<hd::rbf_op> ops{hd::rbf_op::dx, hd::rbf_op::dxy, hd::rbf_op::laplacian};
+        auto mat = hd::rbf_fd_operators<2>(pts, ops, {2, 0, 3});
+        REQUIRE(mat.size() == 3);
+        bool sorted = true;
+        for (std::size_t i = 0; i < pts.size(); ++i)
+            for (std::size_t p = mat[0].row_ptr[i] + 1; p < mat[0].row_ptr[i + 1]; ++p)
+                sorted = sorted && mat[0].col[p - 1] < mat[0].col[p];
+        CHECK(sorted);
+
+        // f = x^2 + x*y + 2*y^2 + x
+        std::vector<double> f, res(pts.size());
+        for (auto const& p : pts)
+            f.push_back(p[0] * p[0] + p[0] * p[1] + 2.0 * p[1] * p[1] + p[0]);
+
+        mat[0].multiply(f, res);
+        for (std::size_t i = 0; i < pts.size(); ++i)
+            CHECK(res[i] == doctest::Approx(2.0 * pts[i][0] + pts[i][1] + 1.0).epsilon(1.0e-8));
+        mat[1].multiply(f, res);
+        for (std::size_t i = 0; i < pts.size(); ++i)
+            CHECK(res[i] == doctest::Approx(1.0).epsilon(1.0e-8));
+        mat[2].multiply(f, res);
+        for (std::size_t i = 0; i < pts.size(); ++i)
+            CHECK(res[i] == doctest::Approx(6.0).epsilon(1.0e-8));
+
+        // batches of local systems (incl. incomplete last batch) and single systems agree
+        auto mat1 = hd::rbf_fd_operators<2>(pts, ops, {2, 0, 3, 1});
+        auto mat5 = hd::rbf_fd_operators<2>(pts, ops, {2, 0, 3, 5});
+        for (std::size_t o = 0; o < ops.size(); ++o) {
+            CHECK(mat1[o].col == mat5[o].col);
+            double diff = 0.0, vmax = 0.0;
+            for (std::size_t p = 0; p < mat1[o].nnz(); ++p) {
+                diff = std::max(diff, std::abs(mat5[o].val[p] - mat1[o].val[p]));
+                vmax = std::max(vmax, std::abs(mat1[o].val[p]));
+            }
+            CHECK(diff <= 1.0e-10 * vmax);
+        }
+    }
+
+    TEST_CASE("rbf_fd_operators(): exact for quadratic polynomials on scattered points in 3D")
+    {
+        // jittered 7 x 7 x 7 grid
+        std::vector<std::array<double, 3>> pts;
+        for (int i = 0; i < 7; ++i)
+            for (int j = 0; j < 7; ++j)
+                for (int k = 0; k < 7; ++k)
+                    pts.push_back({0.1 * i + 0.03 * std::sin(7.0 * i + 3.0 * j - k),
+                                   0.1 * j + 0.03 * std::cos(5.0 * i - 2.0 * j + 2.0 * k),
+                                   0.1 * k + 0.03 * std::sin(3.0 * i + j + 5.0 * k)});
+
+        std::vector<hd::rbf_op> ops{hd::rbf_op::dz, hd::rbf_op::dxz, hd::rbf_op::dyz,
+                                    hd::rbf_op::dzz, hd::rbf_op::laplacian};
+        auto mat = hd::rbf_fd_operators<3>(pts, ops, {2, 0, 3});
+        REQUIRE(mat.size() == 5);
+
+        // f = x^2 + x*y + 2*y^2 + x + 3*z^2 + y*z - x*z + z
+        std::vector<double> f, res(pts.size());
+        for (auto const& p : pts)
+            f.push_back(p[0] * p[0] + p[0] * p[1] + 2.0 * p[1] * p[1] + p[0] + 3.0 * p[2] * p[2] +
+                        p[1] * p[2] - p[0] * p[2] + p[2]);
+
+        mat[0].multiply(f, res);
+        for (std::size_t i = 0; i < pts.size(); ++i)
+            CHECK(res[i] ==
+                  doctest::Approx(6.0 * pts[i][2] + pts[i][1] - pts[i][0] + 1.0).epsilon(1.0e-8));
+        std::vector<double> expected{-1.0, 1.0, 6.0, 12.0};
+        for (std::size_t o = 1; o < ops.size(); ++o) {
+            mat[o].multiply(f, res);
+            double err = 0.0;
+            for (std::size_t i = 0; i < pts.size(); ++i)
+                err = std::max(err, std::abs(res[i] - expected[o - 1]));
+            CHECK(err <= 1.0e-7 * std::abs(expected[o - 1]));
+        }
+    }
+}
+
+TEST_SUITE("compact_filter:")
+{
+    TEST_CASE("compact_filter: removes odd-even mode, keeps linear functions")
+    {
+        const std::size_t n0 = 4, n1 = 17, n2 = 3;
+        const double h = 0.1;
+
+        std::vector<double> mem_f(n0 * n1 * n2), mem_ff(n0 * n1 * n2), mem_df(n0 * n1 * n2);
+        hd::field3d_t f{mem_f.data(), n0, n1, n2};
+        hd::field3d_t ff{mem_ff.data(), n0, n1, n2};
+        hd::field3d_t df{mem_df.data(), n0, n1, n2};
+
+        // f = 2 y + 1 + 0.1 (-1)^j along axis 1
+        for (std::size_t i = 0; i < n0; ++i)
+            for (std::size_t j = 0; j < n1; ++j)
+                for (std::size_t k = 0; k < n2; ++k)
+                    f[i, j, k] = 2.0 * j * h + 1.0 + ((j % 2 == 0) ? 0.1 : -0.1);
+
+        // explicit filter: odd-even mode removed exactly except at the boundary points
+        hd::compact_filter ex(n1, 10, 0.0);
+        ex.apply(f, ff, 1);
+        for (std::size_t j = 1; j + 1 < n1; ++j)
+            CHECK(ff[1, j, 2] == doctest::Approx(2.0 * j * h + 1.0).epsilon(1.0e-12));
+        CHECK(ff[1, 0, 2] == f[1, 0, 2]);
+
+        // linear function unchanged by compact filter, derivative of filtered field
+        for (std::size_t i = 0; i < n0; ++i)
+            for (std::size_t j = 0; j < n1; ++j)
+                for (std::size_t k = 0; k < n2; ++k)
+                    f[i, j, k] = 2.0 * j * h + 1.0;
+        hd::compact_filter flt(n1, 8, 0.45);
+        hd::compact_derivative d1(n1, h);
+        hd::filter_and_derive(flt, d1, hd::cfield3d_t(f), ff, df, 1);
+        for (std::size_t j = 0; j < n1; ++j) {
+            CHECK(ff[3, j, 0] == doctest::Approx(f[3, j, 0]).epsilon(1.0e-12));
+            CHECK(df[3, j, 0] == doctest::Approx(2.0).epsilon(1.0e-10));
+        }
+    }
+}
+
+TEST_SUITE("richardson_weights():")
+{
+    TEST_CASE("richardson_weights(): 3 point f' extrapolated to 6th order")
+    {
+        const std::size_t n = 16;
+        const double h = 0.1;
+
+        hd::stencil_t s(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {});
+        auto rw = hd::richardson_weights(s, h, 3);
+        CHECK(rw.order == 6);
+        CHECK(rw.w.radius() == 4);
+
+        std::vector<double> mem_f(n), mem_df(n, 0.0), mem_err(n, 0.0);
+        hd::field3d_t f{mem_f.data(), 1, 1, n};
+        hd::field3d_t df{mem_df.data(), 1, 1, n};
+        hd::field3d_t err{mem_err.data(), 1, 1, n};
+
+        // f = x^6 (exact for the extrapolated stencil)
+        for (std::size_t k = 0; k < n; ++k)
+            f[0, 0, k] = std::pow(k * h, 6);
+
+        std::vector<hd::fused_output> out{{df, {{2, rw.w}}}, {err, {{2, rw.err}}}};
+        hd::apply_fused(f, out);
+
+        for (std::size_t k = 4; k < n - 4; ++k) {
+            double x = k * h;
+            double exact = 6.0 * std::pow(x, 5);
+            double central = (std::pow(x + h, 6) - std::pow(x - h, 6)) / (2.0 * h);
+            CHECK(df[0, 0, k] == doctest::Approx(exact).epsilon(1.0e-10));
+            CHECK(err[0, 0, k] == doctest::Approx(central - exact).epsilon(1.0e-8));
+        }
+    }
+
+    TEST_CASE("richardson_weights(): symmetry detected for non-round h")
+    {
+        const double h = 0.037;
+
+        // 3 point f': center weight is rounding noise, coefficients of q = 2
+        hd::stencil_t s3(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {});
+        auto r3 = hd::richardson_weights(s3, h, 3);
+        CHECK(r3.order == 6);
+        REQUIRE(r3.c.size() == 3);
+        CHECK(r3.c[0] == doctest::Approx(64.0 / 45.0));
+        CHECK(r3.c[1] == doctest::Approx(-4.0 / 9.0));
+        CHECK(r3.c[2] == doctest::Approx(1.0 / 45.0));
+
+        // 5 point f' and f''
+        for (double hh : {0.1, h}) {
+            hd::stencil_t s5(0.0, hd::stencil_lhs::f1, {-2 * hh, -hh, 0.0, hh, 2 * hh}, {0.0},
+                             {});
+            CHECK(hd::richardson_weights(s5, hh, 3).order == 8);
+            CHECK(hd::richardson_weights(s5, hh, 2).order == 6);
+            hd::stencil_t s5d2(0.0, hd::stencil_lhs::f2, {-2 * hh, -hh, 0.0, hh, 2 * hh}, {},
+                               {0.0});
+            CHECK(hd::richardson_weights(s5d2, hh, 3).order == 8);
+        }
+
+        // extrapolated 5 point f' exact for x^8
+        const std::size_t n = 24;
+        hd::stencil_t s5(0.0, hd::stencil_lhs::f1, {-2 * h, -h, 0.0, h, 2 * h}, {0.0}, {});
+        auto r5 = hd::richardson_weights(s5, h, 3);
+        CHECK(r5.w.radius() == 8);
+
+        std::vector<double> mem_f(n), mem_df(n, 0.0);
+        hd::field3d_t f{mem_f.data(), 1, 1, n};
+        hd::field3d_t df{mem_df.data(), 1, 1, n};
+        for (std::size_t k = 0; k < n; ++k)
+            f[0, 0, k] = std::pow(k * h, 8);
+
+        std::vector<hd::fused_output> out{{df, {{2, r5.w}}}};
+        hd::apply_fused(f, out);
+        for (std::size_t k = 8; k < n - 8; ++k)
+            CHECK(df[0, 0, k] == doctest::Approx(8.0 * std::pow(k * h, 7)).epsilon(1.0e-7));
+    }
+}
+
+TEST_SUITE("moving_stencil:")
+{
+    TEST_CASE("moving_stencil: skipped, refined and refactored updates")
+    {
+        std::vector<double> xf0{-0.2, -0.1, 0.0, 0.1, 0.2}, xf1{0.0};
+        hd::moving_stencil ms(0.0, hd::stencil_lhs::f1, xf0, xf1, {});
+        hd::moving_stats st;
+
+        auto same_as_stencil_t = [&](double x0) {
+            hd::stencil_t s(x0, hd::stencil_lhs::f1, xf0, xf1, {});
+            for (int j = 0; j < s.nf0(); ++j)
+                CHECK(ms.wf0()[j] == doctest::Approx(s.wf0[j]).epsilon(1.0e-11));
+        };
+
+        // small shift of one point: below move_tol
+        xf0[1] += 1.0e-6;
+        CHECK(ms.update(0.0, xf0, xf1, {}, {1.0e-4}, &st) == hd::moving_update::skipped);
+
+        // moderate shifts: refinement with the old factorization
+        for (int step = 0; step < 3; ++step) {
+            xf0[1] += 1.0e-3;
+            xf0[3] -= 5.0e-4;
+            auto u = ms.update(0.0, xf0, xf1, {}, {}, &st);
+            CHECK(u != hd::moving_update::skipped);
+            same_as_stencil_t(0.0);
+        }
+        CHECK(st.skipped == 1);
+        CHECK(st.refined + st.refactored == 3);
+        CHECK(st.refined >= 1);
+
+        // large shift of all points: refactored
+        for (auto& x : xf0)
+            x *= 3.0;
+        xf0[2] += 0.1;
+        CHECK(ms.update(0.0, xf0, xf1, {}, {0.0, 1.0e-12, 1}, &st) == hd::moving_update::refactored);
+        same_as_stencil_t(0.0);
+    }
+}
+
+TEST_SUITE("amr_grid1d:")
+{
+    TEST_CASE("amr_grid1d: local rebuild after refine and coarsen")
+    {
+        std::vector<double> x;
+        for (int i = 0; i <= 40; ++i)
+            x.push_back(0.025 * i + 0.01 * std::sin(double(i)));
+        hd::amr_grid1d g(x, hd::stencil_lhs::f1, 5);
+
+        // 5 point stencils are exact for polynomials of degree 4
+        auto check_exact = [&]() {
+            std::vector<double> f, df(g.size());
+            for (double xi : g.x())
+                f.push_back(xi * xi * xi * xi - xi);
+            g.apply(f, df);
+            for (std::size_t i = 0; i < g.size(); ++i)
+                CHECK(df[i] == doctest::Approx(4.0 * std::pow(g.x()[i], 3) - 1.0).epsilon(1.0e-8));
+        };
+        check_exact();
+
+        auto rep = g.refine(0.4, 0.6);
+        CHECK(rep.inserted > 0);
+        CHECK(g.size() == x.size() + rep.inserted);
+        CHECK(rep.rebuilt <= rep.inserted + 2 * (rep.inserted + 1) + 8);
+        CHECK(rep.rebuilt < g.size());
+        check_exact();
+
+        rep = g.coarsen(0.4, 0.6);
+        CHECK(rep.removed > 0);
+        CHECK(rep.rebuilt < g.size());
+        check_exact();
+
+        // refinement at the boundary
+        rep = g.refine(0.9, 2.0);
+        CHECK(rep.inserted > 0);
+        check_exact();
+    }
+}
+
+TEST_SUITE("spectrum and max. stable dt:")
+{
+    TEST_CASE("spectrum: 1D laplacian and central first derivative")
+    {
+        // dirichlet laplacian: lambda_k = -4/h^2 sin^2(k pi h / 2), k = 1 ... n
+        std::size_t n = 60;
+        double h = 1.0 / (n + 1);
+        hd::csr_matrix a{n, n, {0}, {}, {}};
+        for (std::size_t i = 0; i < n; ++i) {
+            for (int o = -1; o <= 1; ++o) {
+                if ((i == 0 && o < 0) || (i + 1 == n && o > 0)) continue;
+                a.col.push_back(i + o);
+                a.val.push_back((o == 0 ? -2.0 : 1.0) / (h * h));
+            }
+            a.row_ptr.push_back(a.val.size());
+        }
+        double lmin = -4.0 / (h * h) * std::pow(std::sin(n * std::numbers::pi * h / 2.0), 2);
+        double lmax = -4.0 / (h * h) * std::pow(std::sin(std::numbers::pi * h / 2.0), 2);
+
+        auto g = hd::gershgorin_box(a);
+        CHECK(g.re_min <= lmin);
+        CHECK(g.re_max >= lmax);
+        CHECK(g.im_max == doctest::Approx(2.0 / (h * h)));
+
+        CHECK(hd::power_iteration(a, 2000, 1.0e-10) == doctest::Approx(-lmin).epsilon(1.0e-3));
+
+        auto l = hd::lanczos_box(a, 60);
+        CHECK(l.re_min == doctest::Approx(lmin).epsilon(1.0e-10));
+        CHECK(l.re_max == doctest::Approx(lmax).epsilon(1.0e-10));
+
+        // von neumann symbols of the central stencils
+        hd::stencil_weights d1{{-1, 1}, {-0.5 / h, 0.5 / h}};
+        hd::stencil_weights d2{{-1, 0, 1}, {1.0 / (h * h), -2.0 / (h * h), 1.0 / (h * h)}};
+        std::vector<hd::axis_stencil> t1{{0, d1}}, t2{{0, d2}, {1, d2}};
+        auto s1 = hd::von_neumann_symbol(t1);
+        auto s2 = hd::von_neumann_symbol(t2);
+        auto b1 = hd::bounding_box(s1);
+        auto b2 = hd::bounding_box(s2);
+        CHECK(b1.im_max == doctest::Approx(1.0 / h));
+        CHECK(std::abs(b1.re_max) < 1.0e-10);
+        CHECK(b2.re_min == doctest::Approx(-8.0 / (h * h)));
+        CHECK(b2.im_max < 1.0e-8);
+
+        // stability limits: rk3 on the imaginary axis sqrt(3), ssp2 on the real axis 2,
+        // rk3 on the real axis 2.5127
+        auto tab = hd::lsrk_williamson3();
+        auto rk3 = [&](std::complex<double> z) { return hd::stability_function(tab, z); };
+        CHECK(hd::max_stable_dt(rk3, s1) == doctest::Approx(std::sqrt(3.0) * h).epsilon(1.0e-6));
+        CHECK(hd::max_stable_dt(hd::ssprk3_stability, s1) ==
+              doctest::Approx(std::sqrt(3.0) * h).epsilon(1.0e-6));
+        CHECK(hd::max_stable_dt(hd::ssprk2_stability, s2) ==
+              doctest::Approx(2.0 * h * h / 8.0).epsilon(1.0e-6));
+        CHECK(hd::max_stable_dt(rk3, hd::box_boundary({l.re_min, 0.0, 0.0})) ==
+              doctest::Approx(2.5127 / -l.re_min).epsilon(1.0e-4));
+        CHECK(hd::max_stable_dt(hd::ssprk2_stability, s1) < 1.0e-2 * h); // unstable (marginal)
+    }
+}
+
+TEST_SUITE("assemble_csr():")
+{
+    TEST_CASE("assemble_csr(): 2D laplacian with one-sided closures")
+    {
+        double h = 0.1;
+        std::size_t ny = 7, nx = 9;
+        auto d2_at = [&](std::vector<double> x) {
+            return hd::stencil_weights{hd::stencil_t(0.0, hd::stencil_lhs::f2, x, {}, {0.0}), h};
+        };
+        auto d2 = d2_at({-h, 0.0, h});
+        auto d2l = d2_at({0.0, h, 2 * h, 3 * h});
+        auto d2r = d2_at({-3 * h, -2 * h, -h, 0.0});
+        std::vector<hd::axis_operator> lap{{1, d2, {d2l}, {d2r}}, {2, d2, {d2l}, {d2r}}};
+
+        auto a = hd::assemble_csr({1, ny, nx}, lap, 3);
+        CHECK(a.nrows == ny * nx);
+        // interior rows: 5 entries, boundary rows: 4 + 2 or 4 + 4 entries (center shared)
+        std::size_t nnz = (ny - 2) * (nx - 2) * 5 + 2 * (ny - 2) * 6 + 2 * (nx - 2) * 6 + 4 * 7;
+        CHECK(a.nnz() == nnz);
+        for (std::size_t r = 0; r < a.nrows; ++r)
+            for (std::size_t p = a.row_ptr[r] + 1; p < a.row_ptr[r + 1]; ++p)
+                CHECK(a.col[p - 1] < a.col[p]);
+
+        // exact for quadratic functions (incl. closures)
+        std::vector<double> f(ny * nx), lf(ny * nx);
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i)
+                f[j * nx + i] = std::pow(j * h, 2) + 3.0 * std::pow(i * h, 2) + i * h;
+        a.multiply(f, lf);
+        for (double v : lf)
+            CHECK(v == doctest::Approx(8.0));
+
+        // interior stencil only: exceeds the grid
+        std::vector<hd::axis_operator> bad{{2, d2, {}, {}}};
+        CHECK_THROWS(hd::assemble_csr({1, 1, nx}, bad));
+    }
+}
+
+TEST_SUITE("padded_field:")
+{
+    TEST_CASE("padded_field: ghost fills and branch-free laplacian")
+    {
+        double h = 0.1;
+        hd::stencil_weights d2{{-1, 0, 1}, {1.0 / (h * h), -2.0 / (h * h), 1.0 / (h * h)}};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+        std::array<std::size_t, 3> n{5, 6, 11};
+
+        hd::padded_field u(n, hd::terms_radius(lap)), lu(n, {0, 0, 0});
+        CHECK(reinterpret_cast<std::uintptr_t>(&u[0, 0, 0]) % hd::padded_field::alignment == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(&u[3, 2, 0]) % hd::padded_field::alignment == 0);
+
+        // quadratic function: extrapolation through 3 points and the laplacian are exact
+        auto v = u.interior();
+        for (std::size_t i = 0; i < n[0]; ++i)
+            for (std::size_t j = 0; j < n[1]; ++j)
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    v[i, j, k] = std::pow(i * h, 2) + 2.0 * std::pow(j * h, 2) - std::pow(k * h, 2) + i * j * h * h;
+        auto ex = hd::ghost_fill::extrapolate;
+        u.fill_ghosts({ex, ex, ex}, {ex, ex, ex});
+        CHECK(u[-1, -1, -1] == doctest::Approx(2.0 * h * h + h * h));
+        hd::apply_padded(u, lu, lap);
+        for (std::size_t i = 0; i < n[0]; ++i)
+            for (std::size_t j = 0; j < n[1]; ++j)
+                for (std::size_t k = 0; k < n[2]; ++k)
+                    CHECK(lu[i, j, k] == doctest::Approx(4.0));
+
+        // periodic, even and odd fills
+        auto pe = hd::ghost_fill::periodic;
+        u.fill_ghosts({pe, hd::ghost_fill::even, pe}, {pe, hd::ghost_fill::odd, pe});
+        CHECK(u[-1, 2, 3] == u[4, 2, 3]);
+        CHECK(u[5, 2, 3] == u[0, 2, 3]);
+        CHECK(u[1, 2, -1] == u[1, 2, 10]);
+        CHECK(u[1, -1, 3] == u[1, 1, 3]);
+        CHECK(u[1, 6, 3] == doctest::Approx(2.0 * u[1, 5, 3] - u[1, 4, 3]));
+        CHECK(u[-1, -1, -1] == u[4, 1, 10]);
+
+        CHECK_THROWS(hd::apply_padded(lu, u, lap));
+
+        // ghost layers as wide as the extent: periodic only
+        hd::padded_field w({3, 4, 2}, {1, 1, 2});
+        CHECK_NOTHROW(w.fill_ghosts(2, pe, pe));
+        CHECK_THROWS(w.fill_ghosts(2, hd::ghost_fill::even, pe));
+        CHECK_THROWS(w.fill_ghosts(2, pe, hd::ghost_fill::odd));
+        CHECK_NOTHROW(w.fill_ghosts(1, hd::ghost_fill::even, hd::ghost_fill::odd));
+    }
+}
+
+TEST_SUITE("advance_slabs():")
+{
+    TEST_CASE("advance_slabs(): same result as unblocked time steps")
+    {
+        const std::size_t n0 = 23, n1 = 9, n2 = 7;
+        const double h = 0.1;
+
+        std::vector<double> mem_a(n0 * n1 * n2), mem_w(n0 * n1 * n2);
+        for (std::size_t i = 0; i < mem_a.size(); ++i)
+            mem_a[i] = std::sin(0.37 * i);
+        std::vector<double> mem_0 = mem_a;
+        hd::field3d_t ua{mem_a.data(), n0, n1, n2};
+        hd::field3d_t work{mem_w.data(), n0, n1, n2};
+
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2,
+                                             {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}),
+                               h};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+        hd::advance(ua, work, lap, 1.0e-4, 13);
+
+        for (unsigned nslabs : {1u, 4u, 11u, 50u}) {
+            std::vector<double> mem_b = mem_0;
+            hd::field3d_t ub{mem_b.data(), n0, n1, n2};
+            hd::advance_slabs(ub, lap, 1.0e-4, 13, nslabs);
+            for (std::size_t i = 0; i < mem_a.size(); ++i)
+                CHECK(mem_a[i] == mem_b[i]);
+        }
+    }
+
+    TEST_CASE("slab_field: persistent slabs over several calls of advance()")
+    {
+        const std::size_t n0 = 23, n1 = 9, n2 = 7;
+        const double h = 0.1;
+
+        std::vector<double> mem_0(n0 * n1 * n2), mem_w(n0 * n1 * n2);
+        for (std::size_t i = 0; i < mem_0.size(); ++i)
+            mem_0[i] = std::sin(0.37 * i);
+        std::vector<double> mem_5 = mem_0, mem_13 = mem_0;
+        hd::field3d_t work{mem_w.data(), n0, n1, n2};
+
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2,
+                                             {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}),
+                               h};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+        hd::advance(hd::field3d_t{mem_5.data(), n0, n1, n2}, work, lap, 1.0e-4, 5);
+        hd::advance(hd::field3d_t{mem_13.data(), n0, n1, n2}, work, lap, 1.0e-4, 13);
+
+        for (unsigned nslabs : {1u, 4u, 11u}) {
+            hd::slab_field f({n0, n1, n2}, 2, nslabs);
+            CHECK(f.slabs() == nslabs);
+            std::vector<double> mem_b = mem_0;
+            hd::field3d_t ub{mem_b.data(), n0, n1, n2};
+            f.scatter(ub);
+            f.advance(lap, 1.0e-4, 5);
+            f.gather(ub);
+            CHECK(mem_b == mem_5);
+            f.advance(lap, 1.0e-4, 8);
+            f.gather(ub);
+            CHECK(mem_b == mem_13);
+        }
+
+        // ghost planes narrower than the stencil
+        hd::slab_field f1({n0, n1, n2}, 1, 4);
+        CHECK_THROWS(f1.advance(lap, 1.0e-4, 1));
+    }
+}
+
+TEST_SUITE("advance_shm():")
+{
+    TEST_CASE("advance_shm(): slabs exchanging through shared memory")
+    {
+        const std::size_t n0 = 17, n1 = 6, n2 = 5, plane = n1 * n2;
+        const double h = 0.1;
+        const unsigned np = 3;
+
+        std::vector<double> mem_a(n0 * plane), mem_w(n0 * plane), mem_b(n0 * plane);
+        for (std::size_t i = 0; i < mem_a.size(); ++i)
+            mem_a[i] = std::sin(0.37 * i);
+        std::vector<double> mem_0 = mem_a;
+        hd::field3d_t ua{mem_a.data(), n0, n1, n2};
+        hd::field3d_t work{mem_w.data(), n0, n1, n2};
+
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2,
+                                             {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}),
+                               h};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+        hd::advance(ua, work, lap, 1.0e-4, 9);
+
+        // the processes are emulated by threads (each with its own exchange and field)
+        std::string prefix = "/hd_test_" + std::to_string(::getpid());
+        std::vector<std::jthread> procs;
+        for (unsigned p = 0; p < np; ++p) {
+            procs.emplace_back([&, p] {
+                hd::shm_halo_exchange ex(prefix, n0, plane, np, p, 2);
+                auto sl = ex.slab();
+                std::vector<double> mem(mem_0.begin() + (sl.i0 - sl.hlo) * plane,
+                                        mem_0.begin() + (sl.i1 + sl.hhi) * plane);
+                hd::field3d_t u{mem.data(), sl.planes(), n1, n2};
+                hd::advance_shm(u, lap, 1.0e-4, 9, ex);
+                std::copy(mem.begin() + sl.hlo * plane, mem.begin() + (sl.hlo + sl.i1 - sl.i0) * plane,
+                          mem_b.begin() + sl.i0 * plane);
+            });
+        }
+        procs.clear();
+
+        for (std::size_t i = 0; i < mem_a.size(); ++i)
+            CHECK(mem_a[i] == mem_b[i]);
+
+        // field with planes of another size than the exchange
+        hd::shm_halo_exchange single(prefix + "_single", n0, plane, 1, 0, 2);
+        CHECK(single.plane() == plane);
+        std::vector<double> mem_s(n0 * (n1 + 1) * n2);
+        CHECK_THROWS(hd::advance_shm(hd::field3d_t{mem_s.data(), n0, n1 + 1, n2}, lap, 1.0e-4, 1,
+                                     single));
+    }
+}
+
+TEST_SUITE("block_autotuner:")
+{
+    TEST_CASE("block_autotuner: benchmark on first use, reload from cache file")
+    {
+        const std::size_t n0 = 12, n1 = 10, n2 = 8;
+        const double h = 0.1;
+        std::vector<double> mem(n0 * n1 * n2);
+        for (std::size_t i = 0; i < mem.size(); ++i)
+            mem[i] = std::sin(0.37 * i);
+        hd::cfield3d_t u{mem.data(), n0, n1, n2};
+
+        hd::stencil_weights d2{{-1, 0, 1}, {1.0 / (h * h), -2.0 / (h * h), 1.0 / (h * h)}};
+        std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+
+        std::string cache = (std::filesystem::temp_directory_path() /
+                             ("hd_autotune_test_" + std::to_string(::getpid()) + ".cache"))
+                                .string();
+        hd::autotune_param par{cache, {4, 8, 64}, {1, 2}, {1, 2}, 1};
+
+        hd::block_autotuner t1(par);
+        auto blk = t1.tune(u, lap, 1.0e-4);
+        CHECK(t1.benchmarks() == 3 * 3 * 2 * 2); // tile 64 limited to the extents
+        CHECK((blk.steps == 1 || blk.steps == 2));
+        CHECK((blk.tile0 == 4 || blk.tile0 == 8 || blk.tile0 == n0));
+        CHECK((blk.threads == 1 || blk.threads == 2));
+        CHECK(mem[5] == std::sin(0.37 * 5)); // field unchanged
+
+        hd::block_autotuner t2(par);
+        auto blk2 = t2.tune(u, lap, 1.0e-4);
+        CHECK(t2.benchmarks() == 0);
+        CHECK(blk2.steps == blk.steps);
+        CHECK(blk2.tile0 == blk.tile0);
+        CHECK(blk2.tile1 == blk.tile1);
+        CHECK(blk2.threads == blk.threads);
+
+        std::filesystem::remove(cache);
+    }
+}
+
+TEST_SUITE("convergence_study():")
+{
+    TEST_CASE("convergence_study(): observed order of central stencils for f'")
+    {
+        auto f = [](double x) { return std::sin(3.0 * x); };
+        auto df = [](double x) { return 3.0 * std::cos(3.0 * x); };
+        hd::convergence_param par{0.0, 1.0, 17, 5, 2, 3};
+
+        hd::stencil_t s3(0.0, hd::stencil_lhs::f1, {-1.0, 0.0, 1.0}, {0.0}, {});
+        hd::stencil_t s5(0.0, hd::stencil_lhs::f1, {-2.0, -1.0, 0.0, 1.0, 2.0}, {0.0}, {});
+        auto r3 = hd::convergence_study(s3, f, df, par);
+        auto r5 = hd::convergence_study(s5, f, df, par);
+
+        REQUIRE(r3.levels.size() == 5);
+        REQUIRE(r3.order_observed.size() == 4);
+        CHECK(r3.levels[4].n == 16 * 16 + 1);
+        CHECK(r3.levels[1].h == doctest::Approx(r3.levels[0].h / 2.0));
+        CHECK(r3.order_expected == 2);
+        CHECK(r5.order_expected == 4);
+        CHECK(r3.order_fit == doctest::Approx(2.0).epsilon(0.05));
+        CHECK(r5.order_fit == doctest::Approx(4.0).epsilon(0.05));
+        CHECK(r3.order_observed.back() == doctest::Approx(2.0).epsilon(0.02));
+        CHECK(r5.levels.back().err_max < r3.levels.back().err_max);
+
+        double c = r3.cost(1.0e-8);
+        CHECK(c > 0.0);
+        CHECK(std::isfinite(c));
+        CHECK(!r5.summary().empty());
+
+        CHECK_THROWS(hd::convergence_study(s3, f, df, {0.0, 1.0, 1, 5, 1, 1}));
+    }
+}
+
+TEST_SUITE("thread_pool:")
+{
+    TEST_CASE("thread_pool: results and exceptions of submitted tasks")
+    {
+        hd::thread_pool pool(3);
+        CHECK(pool.size() == 3);
+        std::vector<std::future<int>> res;
+        for (int i = 0; i < 20; ++i)
+            res.push_back(pool.submit([i] { return i * i; }));
+        for (int i = 0; i < 20; ++i)
+            CHECK(res[i].get() == i * i);
+
+        auto e = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+        CHECK_THROWS(e.get());
+    }
+}
+
+TEST_SUITE("lsrk_step(), ssprk2_step(), ssprk3_step():")
+{
+    TEST_CASE("time integrators: observed order on y' = lambda y")
+    {
+        const double lambda = -1.0, t_end = 1.0;
+
+        // scalar rhs as 1x1x1 field: dst = alpha*aux + beta*src + gdt*lambda*src
+        auto op = [lambda](double, hd::cfield3d_t src, hd::cfield3d_t aux, hd::field3d_t dst,
+                           double alpha, double beta, double gdt) {
+            dst[0, 0, 0] = alpha * aux[0, 0, 0] + beta * src[0, 0, 0] + gdt * lambda * src[0, 0, 0];
+        };
+
+        // max. error at t_end for nsteps time steps
+        auto error = [&](int scheme, int nsteps) {
+            double mem[3] = {1.0, 0.0, 0.0};
+            hd::field3d_t u{mem, 1, 1, 1}, r1{mem + 1, 1, 1, 1}, r2{mem + 2, 1, 1, 1};
+            double dt = t_end / nsteps, t = 0.0;
+            for (int s = 0; s < nsteps; ++s, t += dt) {
+                switch (scheme) {
+                    case 0: hd::lsrk_step(hd::lsrk_williamson3(), op, t, dt, u, r1); break;
+                    case 1: hd::lsrk_step(hd::lsrk_carpenter_kennedy4(), op, t, dt, u, r1); break;
+                    case 2: hd::ssprk2_step(op, t, dt, u, r1); break;
+                    default: hd::ssprk3_step(op, t, dt, u, r1, r2); break;
+                }
+            }
+            return std::abs(mem[0] - std::exp(lambda * t_end));
+        };
+
+        int expected[4] = {3, 4, 2, 3};
+        for (int scheme = 0; scheme < 4; ++scheme) {
+            double p = std::log2(error(scheme, 20) / error(scheme, 40));
+            CHECK(p == doctest::Approx(expected[scheme]).epsilon(0.06));
+        }
+        CHECK(hd::lsrk_williamson3().order == 3);
+        CHECK(hd::lsrk_carpenter_kennedy4().order == 4);
+
+        double mem[2] = {1.0, 0.0};
+        hd::field3d_t u{mem, 1, 1, 1}, same{mem, 1, 1, 1};
+        CHECK_THROWS(hd::ssprk2_step(op, 0.0, 0.1, u, same));
+    }
+
+    TEST_CASE("stencil_rhs: fused stage update on a 3D field")
+    {
+        const std::size_t n0 = 6, n1 = 7, n2 = 9;
+        const double h = 0.1;
+        hd::stencil_weights d1{hd::stencil_t(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {}), h};
+        hd::stencil_weights d2{
+            hd::stencil_t(0.0, hd::stencil_lhs::f2, {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}), h};
+        std::vector<hd::axis_stencil> terms{{0, d1}, {1, d2}, {2, d2}};
+
+        std::vector<double> mem_s(n0 * n1 * n2), mem_a(n0 * n1 * n2), mem_l(n0 * n1 * n2, 0.0),
+            mem_d(n0 * n1 * n2);
+        for (std::size_t i = 0; i < mem_s.size(); ++i) {
+            mem_s[i] = std::sin(0.37 * i);
+            mem_a[i] = std::cos(0.11 * i);
+        }
+        hd::cfield3d_t src{mem_s.data(), n0, n1, n2}, aux{mem_a.data(), n0, n1, n2};
+        hd::field3d_t l{mem_l.data(), n0, n1, n2}, dst{mem_d.data(), n0, n1, n2};
+
+        std::vector<hd::fused_output> out{{l, terms}};
+        hd::apply_fused(src, out);
+
+        const double alpha = 0.3, beta = 0.7, gdt = 0.05;
+        hd::stencil_rhs op(terms);
+        op(0.0, src, aux, dst, alpha, beta, gdt);
+
+        for (std::size_t i = 0; i < n0; ++i) {
+            for (std::size_t j = 0; j < n1; ++j) {
+                for (std::size_t k = 0; k < n2; ++k) {
+                    bool inner = i >= 1 && i + 1 < n0 && j >= 2 && j + 2 < n1 && k >= 2 &&
+                                 k + 2 < n2;
+                    double ref = alpha * aux[i, j, k] + beta * src[i, j, k] +
+                                 (inner ? gdt * l[i, j, k] : 0.0);
+                    CHECK(dst[i, j, k] == doctest::Approx(ref).epsilon(1.0e-13));
+                }
+            }
+        }
+
+        // 2N stages with fused u update (stencil_rhs overload) and with separate passes
+        auto generic = [&op](double t, hd::cfield3d_t s, hd::cfield3d_t a, hd::field3d_t d,
+                             double alpha, double beta, double g) {
+            op(t, s, a, d, alpha, beta, g);
+        };
+        std::vector<double> mem_u1(mem_s), mem_u2(mem_s), mem_r1(mem_s.size()),
+            mem_r2(mem_s.size());
+        hd::field3d_t u1{mem_u1.data(), n0, n1, n2}, r1{mem_r1.data(), n0, n1, n2};
+        hd::field3d_t u2{mem_u2.data(), n0, n1, n2}, r2{mem_r2.data(), n0, n1, n2};
+        auto tab = hd::lsrk_carpenter_kennedy4();
+        for (int s = 0; s < 3; ++s) {
+            hd::lsrk_step(tab, op, 0.0, 1.0e-3, u1, r1);
+            hd::lsrk_step(tab, generic, 0.0, 1.0e-3, u2, r2);
+        }
+        CHECK(mem_u1 == mem_u2);
+    }
+}
+
+TEST_SUITE("stream_apply():")
+{
+    TEST_CASE("stream_apply(): same result as apply_fused() for all slab sizes")
+    {
+        const std::size_t n0 = 12, n1 = 5, n2 = 6;
+        const double h = 0.1;
+        hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2,
+                                             {-3 * h, -2 * h, -h, 0.0, h, 2 * h, 3 * h}, {},
+                                             {0.0}),
+                               h};
+        hd::stencil_weights d1{hd::stencil_t(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {}), h};
+        std::vector<hd::axis_stencil> terms{{0, d2}, {1, d1}, {2, d1}}; // radius 3 in axis 0
+
+        std::vector<double> mem_f(n0 * n1 * n2), mem_r(n0 * n1 * n2, 0.0);
+        for (std::size_t i = 0; i < mem_f.size(); ++i)
+            mem_f[i] = std::sin(0.37 * i) + 0.01 * i;
+        std::vector<hd::fused_output> out{{hd::field3d_t{mem_r.data(), n0, n1, n2}, terms}};
+        hd::apply_fused(hd::cfield3d_t{mem_f.data(), n0, n1, n2}, out);
+
+        auto tmp = std::filesystem::temp_directory_path();
+        std::string pid = std::to_string(::getpid());
+        std::string in_path = (tmp / ("hd_stream_in_" + pid + ".bin")).string();
+        std::string out_path = (tmp / ("hd_stream_out_" + pid + ".bin")).string();
+        {
+            std::ofstream f(in_path, std::ios::binary | std::ios::trunc);
+            f.write(reinterpret_cast<char const*>(mem_f.data()), mem_f.size() * sizeof(double));
+        }
+
+        for (std::size_t slab : {std::size_t(1), std::size_t(2), n0 / 3, n0 + 5}) {
+            hd::stream_apply(in_path, out_path, {n0, n1, n2}, terms, slab);
+            hd::mapped_file res(out_path, hd::map_mode::read, n0 * n1 * n2);
+            REQUIRE(res.size() == mem_r.size());
+            bool same = true;
+            for (std::size_t i = 0; i < mem_r.size(); ++i)
+                same = same && res.data()[i] == mem_r[i]; // bitwise
+            CHECK(same);
+        }
+
+        // missing file, file too short for the extents
+        std::string missing = (tmp / ("hd_stream_missing_" + pid + ".bin")).string();
+        CHECK_THROWS(hd::mapped_file(missing, hd::map_mode::read));
+        CHECK_THROWS(hd::mapped_file(in_path, hd::map_mode::read, n0 * n1 * n2 + 1));
+        CHECK_THROWS(hd::stream_apply(in_path, out_path, {n0 + 1, n1, n2}, terms, 4));
+        CHECK_THROWS(hd::stream_apply(missing, out_path, {n0, n1, n2}, terms, 4));
+
+        std::filesystem::remove(in_path);
+        std::filesystem::remove(out_path);
+    }
+}
+
+TEST_SUITE("apply_mixed():")
+{
+    TEST_CASE("apply_mixed(): double storage exact, float storage with double accumulation")
+    {
+        const std::size_t n0 = 8, n1 = 6, n2 = 20;
+        const double h = 0.1;
+        hd::stencil_weights d1{hd::stencil_t(0.0, hd::stencil_lhs::f1, {-h, 0.0, h}, {0.0}, {}), h};
+        hd::stencil_weights d2{
+            hd::stencil_t(0.0, hd::stencil_lhs::f2, {-2 * h, -h, 0.0, h, 2 * h}, {}, {0.0}), h};
+        std::vector<hd::axis_stencil> terms{{0, d1}, {1, d2}, {2, d1}};
+
+        std::vector<double> mem_f(n0 * n1 * n2), mem_ref(n0 * n1 * n2, 0.0),
+            mem_out(n0 * n1 * n2, 0.0);
+        hd::field3d_t f{mem_f.data(), n0, n1, n2};
+        for (std::size_t i = 0; i < n0; ++i)
+            for (std::size_t j = 0; j < n1; ++j)
+                for (std::size_t k = 0; k < n2; ++k)
+                    f[i, j, k] = std::sin(i * h) * std::cos(0.5 * j * h) + std::sin(2.0 * k * h);
+
+        std::vector<hd::fused_output> out{{hd::field3d_t{mem_ref.data(), n0, n1, n2}, terms}};
+        hd::apply_fused(hd::cfield3d_t(f), out);
+        hd::apply_mixed<double, double>(hd::cfield3d_t(f),
+                                        hd::field3d_t{mem_out.data(), n0, n1, n2}, terms);
+        CHECK(mem_out == mem_ref); // same operations in the same order
+
+        // smooth field, first derivatives: float storage error ~ 1e-6 relative
+        std::vector<hd::axis_stencil> grad{{0, d1}, {2, d1}};
+        auto rep = hd::compare_precision<float, double>(hd::cfield3d_t(f), grad);
+        CHECK(rep.npoints == (n0 - 2) * n1 * (n2 - 2));
+        CHECK(rep.max_rel_err > 1.0e-8);
+        CHECK(rep.max_rel_err < 2.0e-6);
+        CHECK(rep.rms_err <= rep.max_abs_err);
+
+        auto rep_d = hd::compare_precision<double, double>(hd::cfield3d_t(f), grad);
+        CHECK(rep_d.max_abs_err == 0.0);
+    }
+}
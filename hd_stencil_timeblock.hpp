@@ -0,0 +1,283 @@
+#ifndef HD_STENCIL_TIMEBLOCK_H
+#define HD_STENCIL_TIMEBLOCK_H
+
+// repeated explicit stencil sweeps (explicit euler steps u_new = u + dt*L(u)) on 3D fields
+// with temporal blocking
+//
+// L is a sum of stencils along the axes of the field (see hd_stencil_apply.hpp). Points
+// closer to the boundary than the stencil radius of an axis are kept constant (dirichlet).
+//
+// Usage:
+//
+// hd::stencil_weights d2{hd::stencil_t(0.0, hd::stencil_lhs::f2, {-h, 0.0, h}, {}, {0.0}), h};
+// std::vector<hd::axis_stencil> lap{{0, d2}, {1, d2}, {2, d2}};
+//
+// hd::advance(u, work, lap, dt, nsteps);                          // one sweep per time step
+// hd::advance_blocked(u, work, lap, dt, nsteps, {4, 16, 16});     // same result, blocked
+//
+// advance_blocked() copies tiles of the field (plus a halo of radius*steps points in
+// each axis) into cache resident buffers and performs several time steps on them before
+// writing the tile back (overlapped trapezoidal tiling: the halo is recomputed
+// redundantly by neighbouring tiles). The results are identical to advance().
+//
+// Working set per thread: 2 buffers of (tile0 + 2 r0 T) (tile1 + 2 r1 T) (tile2 + 2 r2 T)
+// values (T = steps), e.g. 2 * 24 * 24 * 136 * 8 bytes = 1.25 MB for the defaults, radius
+// 1 and T = 4. tile2 = 0 leaves axis 2 untiled (complete rows, working set grows with n2).
+
+#include "hd/hd_parallel.hpp"      // hd::parallel_for()
+#include "hd/hd_stencil_apply.hpp" // hd::axis_stencil, hd::merge_terms()
+
+#include <algorithm> // std::min(), std::max(), std::copy()
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <utility>   // std::pair, std::swap()
+#include <vector>
+
+namespace hd {
+
+// parameters of temporal blocking
+struct time_block_t {
+    std::size_t steps{4};  // time steps performed on a tile before writing it back
+    std::size_t tile0{16}; // tile size in axis 0
+    std::size_t tile1{16}; // tile size in axis 1
+    unsigned threads{1};   // threads working on the tiles of a time block (0: all)
+    std::size_t tile2{128}; // tile size in axis 2 (0: complete rows)
+};
+
+// rectangular index region [lo, hi) of a 3D field
+struct box_t {
+    std::array<std::size_t, 3> lo;
+    std::array<std::size_t, 3> hi;
+};
+
+// single euler step for the points of region: un = u + dt*L(u)
+void euler_step(cfield3d_t u, field3d_t un, std::span<axis_stencil const> terms, double dt,
+                box_t region);
+
+// nsteps euler steps, result is returned on u (work is used as scratch field)
+void advance(field3d_t u, field3d_t work, std::span<axis_stencil const> terms, double dt,
+             std::size_t nsteps);
+void advance_blocked(field3d_t u, field3d_t work, std::span<axis_stencil const> terms,
+                     double dt, std::size_t nsteps, time_block_t blk = {});
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// euler step on raw row major memory with extents n; taps are given as memory offsets
+inline void euler_step_raw(double const* u, double* un, std::array<std::size_t, 3> n,
+                           std::span<std::pair<std::ptrdiff_t, double> const> taps,
+                           double dt, box_t region)
+{
+    std::ptrdiff_t s0 = n[1] * n[2], s1 = n[2];
+    std::size_t k0 = region.lo[2], k1 = region.hi[2];
+
+    for (std::size_t i = region.lo[0]; i < region.hi[0]; ++i) {
+        for (std::size_t j = region.lo[1]; j < region.hi[1]; ++j) {
+            std::ptrdiff_t row = i * s0 + j * s1;
+            double const* src = u + row;
+            double* dst = un + row;
+            // accumulate L(u) in the destination row, then complete the update
+            double const* t0 = src + taps[0].first;
+            double w0 = taps[0].second;
+            for (std::size_t k = k0; k < k1; ++k)
+                dst[k] = w0 * t0[k];
+            for (std::size_t t = 1; t < taps.size(); ++t) {
+                double const* tt = src + taps[t].first;
+                double w = taps[t].second;
+                for (std::size_t k = k0; k < k1; ++k)
+                    dst[k] += w * tt[k];
+            }
+            for (std::size_t k = k0; k < k1; ++k)
+                dst[k] = src[k] + dt * dst[k];
+        }
+    }
+}
+
+inline std::vector<std::pair<std::ptrdiff_t, double>>
+memory_taps(std::vector<stencil_tap> const& taps, std::array<std::size_t, 3> n)
+{
+    std::vector<std::pair<std::ptrdiff_t, double>> mt;
+    for (auto const& tp : taps)
+        mt.emplace_back(tp.d[0] * static_cast<std::ptrdiff_t>(n[1] * n[2]) +
+                            tp.d[1] * static_cast<std::ptrdiff_t>(n[2]) + tp.d[2],
+                        tp.w);
+    return mt;
+}
+
+// interior region: points with full stencil support
+inline box_t interior(std::array<std::size_t, 3> n, std::array<std::size_t, 3> r)
+{
+    box_t b;
+    for (int a = 0; a < 3; ++a) {
+        b.lo[a] = r[a];
+        b.hi[a] = n[a] > r[a] ? std::max(r[a], n[a] - r[a]) : r[a];
+    }
+    return b;
+}
+
+} // namespace detail
+
+inline void euler_step(cfield3d_t u, field3d_t un, std::span<axis_stencil const> terms,
+                       double dt, box_t region)
+{
+    std::array<std::size_t, 3> n{u.extent(0), u.extent(1), u.extent(2)};
+    if (un.extent(0) != n[0] || un.extent(1) != n[1] || un.extent(2) != n[2] || terms.empty()) {
+        throw std::invalid_argument("hd::euler_step(): field extents incompatible or no terms.");
+    }
+    auto r = terms_radius(terms);
+    auto in = detail::interior(n, r);
+    for (int a = 0; a < 3; ++a) {
+        region.lo[a] = std::max(region.lo[a], in.lo[a]);
+        region.hi[a] = std::min(region.hi[a], in.hi[a]);
+        if (region.lo[a] >= region.hi[a]) return;
+    }
+    auto taps = detail::memory_taps(merge_terms(terms), n);
+    detail::euler_step_raw(u.data_handle(), un.data_handle(), n, taps, dt, region);
+}
+
+inline void advance(field3d_t u, field3d_t work, std::span<axis_stencil const> terms,
+                    double dt, std::size_t nsteps)
+{
+    std::array<std::size_t, 3> n{u.extent(0), u.extent(1), u.extent(2)};
+    if (work.extent(0) != n[0] || work.extent(1) != n[1] || work.extent(2) != n[2]) {
+        throw std::invalid_argument("hd::advance(): field extents incompatible.");
+    }
+    if (nsteps == 0) return;
+
+    // boundary points are never written, i.e. must be present in both fields
+    std::copy(u.data_handle(), u.data_handle() + u.size(), work.data_handle());
+
+    box_t all{{0, 0, 0}, n};
+    field3d_t cur = u, nxt = work;
+    for (std::size_t s = 0; s < nsteps; ++s) {
+        euler_step(cur, nxt, terms, dt, all);
+        std::swap(cur, nxt);
+    }
+    if (cur.data_handle() != u.data_handle()) {
+        std::copy(cur.data_handle(), cur.data_handle() + cur.size(), u.data_handle());
+    }
+}
+
+//******************************************************************************
+// temporal blocking by overlapped (trapezoidal) tiling in all axes
+//
+// For a block of T time steps each tile core is extended by a halo of r*T points
+// (clipped at the boundary of the field) and copied into two local buffers. Step s
+// updates the local region shrunk by r*s at the tile internal edges, i.e. after T steps
+// the tile core is valid and is written back.
+//
+// Tiles only read from the field of the previous time block and write their core into
+// the field of the next one, i.e. tiles are independent of each other and are distributed
+// over blk.threads threads (each with its own local buffers).
+//******************************************************************************
+inline void advance_blocked(field3d_t u, field3d_t work, std::span<axis_stencil const> terms,
+                            double dt, std::size_t nsteps, time_block_t blk)
+{
+    std::array<std::size_t, 3> n{u.extent(0), u.extent(1), u.extent(2)};
+    if (work.extent(0) != n[0] || work.extent(1) != n[1] || work.extent(2) != n[2] ||
+        terms.empty()) {
+        throw std::invalid_argument("hd::advance_blocked(): field extents incompatible or no terms.");
+    }
+    if (blk.steps == 0 || blk.tile0 == 0 || blk.tile1 == 0) { // tile2 == 0: complete rows
+        throw std::invalid_argument("hd::advance_blocked(): invalid blocking parameters.");
+    }
+    if (nsteps == 0) return;
+
+    auto r = terms_radius(terms);
+    auto in = detail::interior(n, r);
+    auto taps = merge_terms(terms);
+
+    // local buffers for the largest tile incl. halo (per thread)
+    std::array<std::size_t, 3> tile{blk.tile0, blk.tile1, blk.tile2 > 0 ? blk.tile2 : n[2]};
+    std::size_t T = std::min(blk.steps, nsteps);
+    std::size_t msize = 1;
+    for (int a = 0; a < 3; ++a)
+        msize *= std::min(n[a], tile[a] + 2 * r[a] * T);
+
+    std::vector<std::array<std::size_t, 3>> tiles; // origin of tile cores
+    for (std::size_t c0 = 0; c0 < n[0]; c0 += tile[0])
+        for (std::size_t c1 = 0; c1 < n[1]; c1 += tile[1])
+            for (std::size_t c2 = 0; c2 < n[2]; c2 += tile[2])
+                tiles.push_back({c0, c1, c2});
+    unsigned nthreads = blk.threads > 0 ? blk.threads : default_threads();
+    nthreads = static_cast<unsigned>(std::min<std::size_t>(nthreads, tiles.size()));
+    std::vector<std::vector<double>> buf_a(nthreads), buf_b(nthreads);
+
+    std::copy(u.data_handle(), u.data_handle() + u.size(), work.data_handle());
+    double* cur = u.data_handle();
+    double* nxt = work.data_handle();
+
+    for (std::size_t done = 0; done < nsteps;) {
+        std::size_t Tb = std::min(T, nsteps - done);
+        auto run_tiles = [&](std::size_t t0, std::size_t t1, unsigned tid) {
+            // allocated (and first touched) by the thread using them
+            buf_a[tid].resize(msize);
+            buf_b[tid].resize(msize);
+
+            for (std::size_t t = t0; t < t1; ++t) {
+                // tile core [c, e) and local region incl. halo [lo, hi) (global indices)
+                std::array<std::size_t, 3> c = tiles[t], e, lo, hi, m;
+                for (int ax = 0; ax < 3; ++ax) {
+                    std::size_t h = r[ax] * Tb;
+                    e[ax] = std::min(n[ax], c[ax] + tile[ax]);
+                    lo[ax] = c[ax] > h ? c[ax] - h : 0;
+                    hi[ax] = std::min(n[ax], e[ax] + h);
+                    m[ax] = hi[ax] - lo[ax];
+                }
+
+                // copy local region into both buffers (boundary points are needed in both)
+                for (std::size_t i = 0; i < m[0]; ++i)
+                    for (std::size_t j = 0; j < m[1]; ++j) {
+                        double const* src = cur + ((lo[0] + i) * n[1] + lo[1] + j) * n[2] + lo[2];
+                        std::copy(src, src + m[2], buf_a[tid].data() + (i * m[1] + j) * m[2]);
+                        std::copy(src, src + m[2], buf_b[tid].data() + (i * m[1] + j) * m[2]);
+                    }
+
+                auto mtaps = detail::memory_taps(taps, m);
+                double* a = buf_a[tid].data();
+                double* b = buf_b[tid].data();
+
+                for (std::size_t s = 1; s <= Tb; ++s) {
+                    // region valid after step s (local indices): shrink at tile internal edges
+                    box_t reg;
+                    for (int ax = 0; ax < 3; ++ax) {
+                        std::size_t glo = lo[ax] == 0 ? in.lo[ax] : lo[ax] + r[ax] * s;
+                        std::size_t ghi = hi[ax] == n[ax] ? in.hi[ax] : hi[ax] - r[ax] * s;
+                        glo = std::max(glo, in.lo[ax]);
+                        ghi = std::min(ghi, in.hi[ax]);
+                        reg.lo[ax] = glo - lo[ax];
+                        reg.hi[ax] = std::max(glo, ghi) - lo[ax];
+                    }
+
+                    if (reg.lo[0] < reg.hi[0] && reg.lo[1] < reg.hi[1] && reg.lo[2] < reg.hi[2])
+                        detail::euler_step_raw(a, b, m, mtaps, dt, reg);
+                    std::swap(a, b);
+                }
+
+                // write back tile core
+                for (std::size_t i = c[0]; i < e[0]; ++i)
+                    for (std::size_t j = c[1]; j < e[1]; ++j) {
+                        double const* src =
+                            a + ((i - lo[0]) * m[1] + j - lo[1]) * m[2] + c[2] - lo[2];
+                        std::copy(src, src + (e[2] - c[2]), nxt + (i * n[1] + j) * n[2] + c[2]);
+                    }
+            }
+        };
+        parallel_for(tiles.size(), run_tiles, nthreads);
+
+        done += Tb;
+        std::swap(cur, nxt);
+    }
+    if (cur != u.data_handle()) {
+        std::copy(cur, cur + u.size(), u.data_handle());
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_TIMEBLOCK_H
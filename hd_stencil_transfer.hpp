@@ -0,0 +1,134 @@
+#ifndef HD_STENCIL_TRANSFER_H
+#define HD_STENCIL_TRANSFER_H
+
+// interpolation between 1D grids (grid transfer, resampling of output, prolongation)
+//
+// The value at each target point is interpolated from np neighbouring source points
+// (centered around the target point as far as possible, one-sided at the boundaries).
+// The weights are moment weights of the 0th derivative (cmp. hd::multi_deriv_weights()
+// with derivs = {0}), computed for all target points in one parallel pass.
+//
+// Target points outside [xs.front(), xs.back()] are extrapolated with the polynomial
+// through the np outermost source points (exact for polynomials of degree < np, but the
+// error grows quickly with the distance from the source grid).
+//
+// Usage:
+//
+// auto tr = hd::make_transfer(x_coarse, x_fine, 4);   // cubic interpolation
+// tr.apply(f_coarse, f_fine);
+
+#include "hd/hd_parallel.hpp" // hd::parallel_for()
+#include "hd/hd_solver.hpp"   // hd::lu_decomp(), hd::lu_backsubs()
+#include "hd/hd_stencil.hpp"  // hd::detail::moment_column()
+
+#include <algorithm> // std::lower_bound(), std::clamp(), std::adjacent_find()
+#include <cstddef>
+#include <functional> // std::greater_equal
+#include <span>
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+
+namespace hd {
+
+struct transfer_weights {
+    std::size_t ns{0};              // number of source points
+    std::size_t nt{0};              // number of target points
+    std::size_t np{0};              // source points per target point
+    std::vector<std::size_t> first; // first source point of each target point
+    std::vector<double> w;          // weights, structure of arrays: w[j * nt + i] for target i
+
+    // ft[i] = sum_j w[j * nt + i] * fs[first[i] + j]
+    void apply(std::span<double const> fs, std::span<double> ft) const;
+};
+
+// xs: source grid, xt: target grid (both strictly increasing), np: points per target point
+transfer_weights make_transfer(std::span<double const> xs, std::span<double const> xt,
+                               std::size_t np = 4, unsigned nthreads = 0);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline transfer_weights make_transfer(std::span<double const> xs, std::span<double const> xt,
+                                      std::size_t np, unsigned nthreads)
+{
+    // strictly increasing: duplicate points give singular moment systems
+    auto increasing = [](std::span<double const> x) {
+        return std::adjacent_find(x.begin(), x.end(), std::greater_equal<>{}) == x.end();
+    };
+    if (np < 1 || xs.size() < np || !increasing(xs) || !increasing(xt)) {
+        throw std::invalid_argument("hd::make_transfer(): grids not strictly increasing or too few source points.");
+    }
+
+    transfer_weights tr;
+    tr.ns = xs.size();
+    tr.nt = xt.size();
+    tr.np = np;
+    tr.first.resize(tr.nt);
+    tr.w.resize(np * tr.nt);
+
+    parallel_for(
+        tr.nt,
+        [&](std::size_t i0, std::size_t i1, unsigned) {
+            // per thread scratch for the moment systems
+            std::vector<double> mem_m(np * np), mem_vv(np), mem_rhs(np);
+            std::vector<int> mem_perm(np);
+            mdspan m{mem_m.data(), np, np};
+            mdspan<int, dextents<std::size_t, 1>> perm{mem_perm.data(), np};
+            mdspan<double, dextents<std::size_t, 1>> vv{mem_vv.data(), np};
+            mdspan<double, dextents<std::size_t, 1>> rhs{mem_rhs.data(), np};
+
+            for (std::size_t i = i0; i < i1; ++i) {
+                double x0 = xt[i];
+
+                // np source points around x0
+                std::ptrdiff_t pos = std::lower_bound(xs.begin(), xs.end(), x0) - xs.begin();
+                std::size_t f = std::clamp<std::ptrdiff_t>(pos - std::ptrdiff_t(np / 2), 0,
+                                                           xs.size() - np);
+                tr.first[i] = f;
+
+                // moment system of the 0th derivative; coordinates scaled with the
+                // extent of the stencil (does not change the weights of f)
+                double h = (np > 1) ? xs[f + np - 1] - xs[f] : 1.0;
+                for (std::size_t j = 0; j < np; ++j) {
+                    detail::moment_column(m, j, (xs[f + j] - x0) / h);
+                    rhs[j] = 0.0;
+                }
+                rhs[0] = 1.0;
+
+                lu_decomp(m, perm, vv);
+                lu_backsubs(m, perm, rhs);
+
+                for (std::size_t j = 0; j < np; ++j)
+                    tr.w[j * tr.nt + i] = rhs[j];
+            }
+        },
+        nthreads);
+
+    return tr;
+}
+
+//******************************************************************************
+// one sweep over the target points per source point of the stencil: contiguous weights,
+// the loops vectorize (gather of the source values)
+//******************************************************************************
+inline void transfer_weights::apply(std::span<double const> fs, std::span<double> ft) const
+{
+    if (fs.size() != ns || ft.size() != nt) {
+        throw std::invalid_argument("hd::transfer_weights::apply(): sizes incompatible.");
+    }
+    double const* wj = w.data();
+    std::size_t const* fi = first.data();
+    for (std::size_t i = 0; i < nt; ++i)
+        ft[i] = wj[i] * fs[fi[i]];
+    for (std::size_t j = 1; j < np; ++j) {
+        wj = w.data() + j * nt;
+        double const* fsj = fs.data() + j;
+        for (std::size_t i = 0; i < nt; ++i)
+            ft[i] += wj[i] * fsj[fi[i]];
+    }
+}
+
+} // namespace hd
+
+#endif // HD_STENCIL_TRANSFER_H
@@ -13,7 +13,7 @@
 
 namespace hd {
 
-std::string now_as_str()
+inline std::string now_as_str()
 {
     // use Howard Hinnants data.h to print current time
     auto now = std::chrono::system_clock::now();
@@ -64,13 +64,13 @@ class stop_watch {
     void reset();
 };
 
-void stop_watch::start()
+inline void stop_watch::start()
 {
     start_time.push_back(std::chrono::steady_clock::now());
     ++start_cnt;
 }
 
-void stop_watch::split()
+inline void stop_watch::split()
 {
     auto now = std::chrono::steady_clock::now();
     // end of current interval (initiated by start() or split())
@@ -81,13 +81,13 @@ void stop_watch::split()
     ++start_cnt;
 }
 
-void stop_watch::stop()
+inline void stop_watch::stop()
 {
     end_time.push_back(std::chrono::steady_clock::now());
     ++stop_cnt;
 }
 
-int stop_watch::elapsed_time(time_in t_in)
+inline int stop_watch::elapsed_time(time_in t_in)
 {
 
     using namespace std::chrono;
@@ -129,11 +129,10 @@ int stop_watch::elapsed_time(time_in t_in)
                 break;
         }
     }
-    else
-        return 0; // otherwise return 0
+    return 0; // otherwise return 0
 }
 
-void stop_watch::reset()
+inline void stop_watch::reset()
 {
     start_time.clear();
     end_time.clear();
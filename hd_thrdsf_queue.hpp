@@ -9,6 +9,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 namespace hd {
 
@@ -17,7 +18,7 @@ class thrdsf_queue {
 
   private:
     mutable std::mutex mtx;
-    std::queue<T> data_queue;
+    std::queue<std::shared_ptr<T>> data_queue;
     std::condition_variable data_cond;
 
   public:
@@ -26,7 +27,7 @@ class thrdsf_queue {
     void push(T new_value)
     {
 
-        std::shared_ptr<T> value(make_shared<T>(std::move(new_value)));
+        std::shared_ptr<T> value(std::make_shared<T>(std::move(new_value)));
         std::lock_guard<std::mutex> lk(mtx);
         data_queue.push(value);
         data_cond.notify_one();
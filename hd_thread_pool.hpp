@@ -0,0 +1,88 @@
+#ifndef HD_THREAD_POOL_HPP
+#define HD_THREAD_POOL_HPP
+//
+// simple thread pool with a fixed number of workers fed by hd::thrdsf_queue
+//
+// Usage:
+//
+// hd::thread_pool pool(4);
+// std::future<double> r = pool.submit([] { return compute(); });
+// double v = r.get();     // exceptions of the task are rethrown by get()
+//
+// The destructor lets the workers finish all submitted tasks before joining them.
+
+#include "hd/hd_parallel.hpp"     // hd::default_threads()
+#include "hd/hd_thrdsf_queue.hpp" // hd::thrdsf_queue
+
+#include <functional> // std::function
+#include <future>     // std::packaged_task, std::future
+#include <memory>     // std::make_shared
+#include <thread>
+#include <type_traits> // std::invoke_result_t
+#include <utility>     // std::move()
+#include <vector>
+
+namespace hd {
+
+class thread_pool {
+  public:
+    explicit thread_pool(unsigned nthreads = default_threads());
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    template <class F>
+    std::future<std::invoke_result_t<F>> submit(F f);
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+  private:
+    thrdsf_queue<std::function<void()>> tasks; // empty function: worker terminates
+    std::vector<std::jthread> workers;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+inline thread_pool::thread_pool(unsigned nthreads)
+{
+    if (nthreads == 0) nthreads = 1;
+    workers.reserve(nthreads);
+    for (unsigned t = 0; t < nthreads; ++t) {
+        workers.emplace_back([this] {
+            for (;;) {
+                std::function<void()> task;
+                tasks.wait_and_pop(task);
+                if (!task) return;
+                task();
+            }
+        });
+    }
+}
+
+inline thread_pool::~thread_pool()
+{
+    // one terminating task per worker, queued behind all submitted tasks
+    for (std::size_t t = 0; t < workers.size(); ++t)
+        tasks.push(std::function<void()>{});
+    workers.clear(); // join
+}
+
+//******************************************************************************
+// std::function must be copyable: the (move only) packaged_task is held by a shared_ptr
+//******************************************************************************
+template <class F>
+std::future<std::invoke_result_t<F>> thread_pool::submit(F f)
+{
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+    std::future<R> res = task->get_future();
+    tasks.push([task] { (*task)(); });
+    return res;
+}
+
+} // namespace hd
+
+#endif // HD_THREAD_POOL_HPP